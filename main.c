@@ -1,22 +1,96 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <time.h>
+#endif
 
 #define ALPHABET_SIZE 26
 #define MAX_WORD_LENGTH 100
 #define MAX_SUGGESTIONS 10
 #define MAX_WORDS 1000
 #define MAX_LEVENSHTEIN_DISTANCE 2
+#define MAX_SPELL_DISTANCE 4
+#define SIGNATURE_BLOCK 16                 // words screened per signature kernel call
+#define GRAM_COUNT (ALPHABET_SIZE * ALPHABET_SIZE)
+#define POSTING_BLOCK 16
+#define PERFECT_HASH_BUCKET_SIZE 4
+#define LABEL_PADDING 32     // readable bytes past the last static child label
+#define BURST_FANOUT 256     // burst trie nodes branch on a whole byte
+#define BURST_SLOTS 16       // hash slots per container
+#define BURST_THRESHOLD 128  // entries a container holds before it bursts into a node
+#define PERFECT_HASH_DIRECT 0x80000000u // seed flag: the low bits are the bucket's slot
+#define MAX_PAGE_SIZE 5000     // largest page a paginated completion request may ask for
+#define MAX_TAGS 32            // category names that fit in a node's tag bitset
+#define HOT_PREFIX_SLOTS 64    // prefix nodes tracked by the heavy-hitter summary
+#define HOT_PREFIX_MIN_HITS 3  // guaranteed queries before a node's top-K is cached
+#define FREQUENCY_BUCKETS 32 // log2 frequency classes used for eviction order
+#define ARENA_CHUNK_SIZE (2 * 1024 * 1024) // the node region grows one 2MB huge page at a time
+#define NODE_REGION_NODES (1u << 25)      // address space reserved for nodes up front
+#define NODE_SEGMENT_NODES (1u << 16)     // first heap segment once nodes spill past the region
+#define NODE_SEGMENTS 17                  // heap segments double in size and cover every 32-bit id
+#define TAIL_BLOCK_SIZE 4096               // one page per tail block
+#define TAIL_MAGIC 0x4C494154u             // "TAIL"
+#define LOAD_CHUNK_SIZE (1024 * 1024)      // bytes per asynchronous read
+#define LINE_READER_SIZE (1024 * 1024)     // buffered standard input; longer lines are cut
+#define QUERY_BLOCK_SIZE (64 * 1024)       // smallest block the per-query arena allocates
+#define LOAD_SLOTS 4                       // reads kept in flight while parsing
+#define LOAD_WORKERS 2                     // pread threads when io_uring is unavailable
+#define INGEST_RING_SIZE 64                // batches buffered between pipeline stages
+#define INGEST_BATCH_WORDS 1024            // words per batch passed between stages
+#define SKETCH_DEPTH 4                     // count-min sketch rows
+#define SKETCH_DEFAULT_WIDTH (1 << 16)     // counters per row unless overridden
+#define SKETCH_DEFAULT_THRESHOLD 3         // sightings before a logged query is promoted
+#define SNAPSHOT_MAGIC 0x504E5354u         // "TSNP"
+#define SNAPSHOT_COMPRESSED 0x1            // blocks are LZ-compressed
+#define SNAPSHOT_TAGGED 0x2                // category table present, each word carries tags
+#define SNAPSHOT_WORKERS 4                 // parallel block decompression threads
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
 
 // Trie Node
+// Only what the prefix walk needs lives in the node itself; the word stored at a
+// node and its subtree summary are kept in separate arrays indexed by node id.
+// Children are 32-bit ids into the contiguous node region, so the region holds no
+// pointers and stays valid wherever it is mapped.
 typedef struct TrieNode {
-    struct TrieNode* children[ALPHABET_SIZE];
+    uint32_t children[ALPHABET_SIZE]; // child node ids, 0 if absent
     bool isEndOfWord;
+    bool isHotPrefix; // tracked by the heavy-hitter prefix table
+} TrieNode;
+
+// Word stored at a terminal node
+typedef struct {
     char* originalWord;
     int frequency; // Added for frequency-based suggestions
-} TrieNode;
+    uint32_t tags; // categories of the word ending here
+} NodePayload;
+
+// Summary of every word below a node, used to prune ranked and filtered searches
+typedef struct {
+    uint32_t tags;         // OR of tags over the subtree
+    uint8_t minLength;     // shortest word in the subtree (UINT8_MAX if none)
+    uint8_t maxLength;     // longest word in the subtree
+    int maxFrequency;      // highest frequency in the subtree (INT_MIN if none)
+} SubtreeSummary;
 
 // Suggestion structure for ranking
 typedef struct {
@@ -29,6 +103,7 @@ typedef struct {
 typedef struct {
     Suggestion suggestions[MAX_SUGGESTIONS];
     int count;
+    bool scratch; // words live in the query arena instead of the heap
 } SuggestionList;
 
 // Dictionary structure
@@ -37,71 +112,537 @@ typedef struct {
     int count;
 } Dictionary;
 
-// Create new Trie node
-TrieNode* createTrieNode() {
-    TrieNode* node = (TrieNode*)calloc(1, sizeof(TrieNode));
-    if (!node) {
+// Compare function for qsort over a Dictionary's words (elements are char*)
+int compareWords(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Node arena: every node is addressed by its node id (id 0 is the null link). On
+// Linux the low ids live in one contiguous region that is reserved up front and
+// committed 2MB at a time, backed by huge pages where available. Ids past the
+// region (or all ids, where it cannot be reserved) live in heap segments that
+// double in size, so node addresses never move as the trie grows. Released nodes
+// are kept on a free list.
+typedef struct {
+    TrieNode* nodes;           // the reserved region, or NULL
+    size_t capacity;           // ids held by the region; later ids go to the segments
+    size_t regionBytes;
+    size_t committed;          // region ids backed by usable memory
+    bool reserved;             // region is an address-space reservation
+    TrieNode* segments[NODE_SEGMENTS]; // segment k holds NODE_SEGMENT_NODES << k nodes
+    uint32_t nextId;           // first id never handed out (0 until the arena is set up)
+    uint32_t freeList;
+    size_t bytesCommitted;
+    size_t nodesInUse;
+    NodePayload* payloads;     // indexed by node id
+    SubtreeSummary* summaries; // indexed by node id
+    size_t idCapacity;
+    bool useHugePages;
+    bool exhausted;            // a node could not be created and that has been reported
+} NodeArena;
+
+NodeArena nodeArena = { .useHugePages = true };
+
+// Reserve the node region (address space only). Where that is not possible every
+// node comes from the heap segments.
+void reserveNodeRegion() {
+#if defined(__linux__)
+    size_t bytes = ((size_t)NODE_REGION_NODES * sizeof(TrieNode) + ARENA_CHUNK_SIZE - 1) &
+                   ~(size_t)(ARENA_CHUNK_SIZE - 1);
+    // Over-reserve and trim so commits land on 2MB boundaries
+    char* raw = mmap(NULL, bytes + ARENA_CHUNK_SIZE, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw != MAP_FAILED) {
+        uintptr_t aligned = ((uintptr_t)raw + ARENA_CHUNK_SIZE - 1) & ~(uintptr_t)(ARENA_CHUNK_SIZE - 1);
+        size_t head = aligned - (uintptr_t)raw;
+        if (head) munmap(raw, head);
+        munmap((char*)aligned + bytes, ARENA_CHUNK_SIZE - head);
+        nodeArena.nodes = (TrieNode*)aligned;
+        nodeArena.capacity = bytes / sizeof(TrieNode);
+        nodeArena.regionBytes = bytes;
+        nodeArena.committed = 0;
+        nodeArena.reserved = true;
+        nodeArena.nextId = 1;
+        return;
+    }
+#endif
+    nodeArena.nodes = NULL;
+    nodeArena.capacity = nodeArena.committed = 0;
+    nodeArena.reserved = false;
+    nodeArena.nextId = 1;
+}
+
+// Commit the next 2MB of the region, preferring explicit huge pages, then THP.
+// Returns false if the region is used up or the memory cannot be committed.
+bool growNodeArena() {
+    if (!nodeArena.reserved || nodeArena.bytesCommitted + ARENA_CHUNK_SIZE > nodeArena.regionBytes) {
+        return false;
+    }
+#if defined(__linux__)
+    char* base = (char*)nodeArena.nodes + nodeArena.bytesCommitted;
+    bool mapped = false;
+#if defined(MAP_HUGETLB)
+    if (nodeArena.useHugePages) {
+        mapped = mmap(base, ARENA_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) != MAP_FAILED;
+    }
+#endif
+    if (!mapped) {
+        if (mmap(base, ARENA_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+            return false;
+        }
+#if defined(MADV_HUGEPAGE)
+        if (nodeArena.useHugePages) madvise(base, ARENA_CHUNK_SIZE, MADV_HUGEPAGE);
+#endif
+    }
+#endif
+    nodeArena.bytesCommitted += ARENA_CHUNK_SIZE;
+    nodeArena.committed = nodeArena.bytesCommitted / sizeof(TrieNode);
+    return true;
+}
+
+// Heap segment of an id past the region, and the first id past the region it holds
+int nodeSegment(uint32_t id, size_t* firstLocal) {
+    size_t local = id - nodeArena.capacity;
+    int segment = 31 - __builtin_clz((uint32_t)(local / NODE_SEGMENT_NODES + 1));
+    *firstLocal = (size_t)NODE_SEGMENT_NODES * ((1u << segment) - 1);
+    return segment;
+}
+
+// Make room for another node id in the payload and summary arrays
+void growNodeIds() {
+    size_t capacity = nodeArena.idCapacity ? nodeArena.idCapacity * 2 : 4096;
+    NodePayload* payloads = (NodePayload*)realloc(nodeArena.payloads, capacity * sizeof(NodePayload));
+    if (payloads) nodeArena.payloads = payloads;
+    SubtreeSummary* summaries = (SubtreeSummary*)realloc(nodeArena.summaries,
+                                                         capacity * sizeof(SubtreeSummary));
+    if (summaries) nodeArena.summaries = summaries;
+    if (!payloads || !summaries) {
         perror("Failed to create Trie node");
         exit(EXIT_FAILURE);
     }
+    nodeArena.idCapacity = capacity;
+}
+
+// Node for a non-zero id
+TrieNode* nodeAt(uint32_t id) {
+    if (id < nodeArena.capacity) return &nodeArena.nodes[id];
+    size_t first;
+    int segment = nodeSegment(id, &first);
+    return nodeArena.segments[segment] + (id - nodeArena.capacity - first);
+}
+
+// Id of a node
+uint32_t nodeId(const TrieNode* node) {
+    uintptr_t address = (uintptr_t)node;
+    uintptr_t region = (uintptr_t)nodeArena.nodes;
+    if (address - region < nodeArena.capacity * sizeof(TrieNode)) return (uint32_t)(node - nodeArena.nodes);
+    size_t first = 0;
+    for (int k = 0; k < NODE_SEGMENTS && nodeArena.segments[k]; ++k) {
+        size_t size = (size_t)NODE_SEGMENT_NODES << k;
+        if (address - (uintptr_t)nodeArena.segments[k] < size * sizeof(TrieNode)) {
+            return (uint32_t)(nodeArena.capacity + first + (node - nodeArena.segments[k]));
+        }
+        first += size;
+    }
+    return 0;
+}
+
+// Child of a node for a letter index, or NULL
+TrieNode* childNode(const TrieNode* node, int index) {
+    uint32_t id = node->children[index];
+    return id ? nodeAt(id) : NULL;
+}
+
+// Link (or with NULL, unlink) a child
+void setChildNode(TrieNode* node, int index, const TrieNode* child) {
+    node->children[index] = child ? nodeId(child) : 0;
+}
+
+// Word stored at a node
+NodePayload* nodePayload(const TrieNode* node) {
+    return &nodeArena.payloads[nodeId(node)];
+}
+
+// Summary of a node's subtree
+SubtreeSummary* nodeSummary(const TrieNode* node) {
+    return &nodeArena.summaries[nodeId(node)];
+}
+
+// Back the next unused id with memory: the region while it lasts, then the heap
+// segments. Returns false once no more nodes can be created.
+bool backNextNodeId() {
+    uint32_t id = nodeArena.nextId;
+    if (id == UINT32_MAX) return false;
+    // A region that cannot be committed further ends here; later ids use the heap
+    if (id < nodeArena.capacity && id >= nodeArena.committed && !growNodeArena()) {
+        nodeArena.capacity = nodeArena.committed;
+    }
+    if (id >= nodeArena.capacity) {
+        size_t first;
+        int segment = nodeSegment(id, &first);
+        if (!nodeArena.segments[segment]) {
+            nodeArena.segments[segment] = (TrieNode*)calloc((size_t)NODE_SEGMENT_NODES << segment,
+                                                            sizeof(TrieNode));
+            if (!nodeArena.segments[segment]) return false;
+        }
+    }
+    if (id >= nodeArena.idCapacity) growNodeIds();
+    return true;
+}
+
+// Create new Trie node; NULL once node memory is exhausted
+TrieNode* createTrieNode() {
+    uint32_t id;
+    if (nodeArena.freeList) {
+        id = nodeArena.freeList;
+        nodeArena.freeList = nodeAt(id)->children[0];
+    } else {
+        if (!nodeArena.nextId) reserveNodeRegion();
+        if (!backNextNodeId()) return NULL;
+        id = nodeArena.nextId++;
+    }
+    TrieNode* node = nodeAt(id);
+    memset(node, 0, sizeof(TrieNode));
     node->isEndOfWord = false;
-    node->originalWord = NULL;
-    node->frequency = 0;
+    NodePayload* payload = nodePayload(node);
+    payload->originalWord = NULL;
+    payload->frequency = 0;
+    payload->tags = 0;
+    SubtreeSummary* summary = nodeSummary(node);
+    summary->tags = 0;
+    summary->minLength = UINT8_MAX;
+    summary->maxLength = 0;
+    summary->maxFrequency = INT_MIN;
+    nodeArena.nodesInUse++;
     return node;
 }
 
-// Convert string to lowercase in place
-void toLowerCase(char* str) {
-    for (; *str; ++str) {
-        *str = tolower((unsigned char)*str);
+// Put a node back on the arena free list
+void releaseTrieNode(TrieNode* node) {
+    node->children[0] = nodeArena.freeList;
+    nodeArena.freeList = nodeId(node);
+    nodeArena.nodesInUse--;
+}
+
+// Release the node region and the per-node arrays
+void destroyNodeArena() {
+#if defined(__linux__)
+    if (nodeArena.reserved) munmap(nodeArena.nodes, nodeArena.regionBytes);
+#endif
+    for (int k = 0; k < NODE_SEGMENTS; ++k) {
+        free(nodeArena.segments[k]);
+        nodeArena.segments[k] = NULL;
+    }
+    nodeArena.nodes = NULL;
+    nodeArena.capacity = 0;
+    nodeArena.regionBytes = 0;
+    nodeArena.committed = 0;
+    nodeArena.reserved = false;
+    nodeArena.nextId = 0;
+    nodeArena.freeList = 0;
+    nodeArena.bytesCommitted = 0;
+    nodeArena.nodesInUse = 0;
+    free(nodeArena.payloads);
+    free(nodeArena.summaries);
+    nodeArena.payloads = NULL;
+    nodeArena.summaries = NULL;
+    nodeArena.idCapacity = 0;
+}
+
+// Vector text kernels. Each handles whole 16- or 32-byte blocks from the start of its
+// input and stops at the first block holding a non-ASCII byte, returning how many
+// bytes it covered; the caller finishes with the scalar ctype path, so non-ASCII
+// input keeps its locale-dependent handling.
+size_t noTextBlocks(char* dst, const char* src, size_t length) {
+    (void)dst;
+    (void)src;
+    (void)length;
+    return 0;
+}
+
+size_t noLetterBlocks(const char* src, size_t length, bool* valid) {
+    (void)src;
+    (void)length;
+    (void)valid;
+    return 0;
+}
+
+#if defined(__SSE2__)
+// Lowercase ASCII 16 bytes at a time: add 0x20 where 'A' <= c <= 'Z'
+size_t foldCaseBlocksSse2(char* dst, const char* src, size_t length) {
+    const __m128i belowA = _mm_set1_epi8('A' - 1), aboveZ = _mm_set1_epi8('Z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(c)) break;
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, belowA), _mm_cmplt_epi8(c, aboveZ));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(c, _mm_and_si128(upper, caseBit)));
+    }
+    return i;
+}
+
+// Check 16 bytes at a time that every byte folds into 'a'..'z'
+size_t letterBlocksSse2(const char* src, size_t length, bool* valid) {
+    const __m128i belowA = _mm_set1_epi8('a' - 1), aboveZ = _mm_set1_epi8('z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(c)) break;
+        __m128i folded = _mm_or_si128(c, caseBit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, belowA), _mm_cmplt_epi8(folded, aboveZ));
+        if (_mm_movemask_epi8(letter) != 0xFFFF) {
+            *valid = false;
+            break;
+        }
+    }
+    return i;
+}
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+// AVX2 forms of the two kernels, 32 bytes at a time
+__attribute__((target("avx2")))
+size_t foldCaseBlocksAvx2(char* dst, const char* src, size_t length) {
+    const __m256i belowA = _mm256_set1_epi8('A' - 1), aboveZ = _mm256_set1_epi8('Z' + 1);
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(c)) break;
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, belowA), _mm256_cmpgt_epi8(aboveZ, c));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(c, _mm256_and_si256(upper, caseBit)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t letterBlocksAvx2(const char* src, size_t length, bool* valid) {
+    const __m256i belowA = _mm256_set1_epi8('a' - 1), aboveZ = _mm256_set1_epi8('z' + 1);
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(c)) break;
+        __m256i folded = _mm256_or_si256(c, caseBit);
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, belowA),
+                                          _mm256_cmpgt_epi8(aboveZ, folded));
+        if ((uint32_t)_mm256_movemask_epi8(letter) != UINT32_MAX) {
+            *valid = false;
+            break;
+        }
+    }
+    return i;
+}
+#endif
+
+#if defined(__SSE2__)
+size_t (*foldCaseBlocks)(char*, const char*, size_t) = foldCaseBlocksSse2;
+size_t (*letterBlocks)(const char*, size_t, bool*) = letterBlocksSse2;
+#else
+size_t (*foldCaseBlocks)(char*, const char*, size_t) = noTextBlocks;
+size_t (*letterBlocks)(const char*, size_t, bool*) = noLetterBlocks;
+#endif
+
+// Lowercase length bytes of src into dst (which may be src)
+void foldCase(char* dst, const char* src, size_t length) {
+    size_t i = foldCaseBlocks(dst, src, length);
+    for (; i < length; ++i) {
+        dst[i] = (char)tolower((unsigned char)src[i]);
+    }
+}
+
+// Check that length bytes are all letters
+bool allLetters(const char* src, size_t length) {
+    bool valid = true;
+    size_t i = letterBlocks(src, length, &valid);
+    if (!valid) return false;
+    for (; i < length; ++i) {
+        if (!isalpha((unsigned char)src[i])) return false;
     }
+    return true;
 }
 
 // Create lowercase copy of string
 char* strtolower(const char* str) {
-    char* lower = strdup(str);
+    size_t length = strlen(str);
+    char* lower = (char*)malloc(length + 1);
     if (!lower) return NULL;
-    toLowerCase(lower);
+    foldCase(lower, str, length);
+    lower[length] = '\0';
     return lower;
 }
 
 // Check if word contains only letters
 bool isValidWord(const char* str) {
-    for (; *str; ++str) {
-        if (!isalpha((unsigned char)*str)) return false;
+    return allLetters(str, strlen(str));
+}
+
+// 64-bit FNV-1a hash of a lowercase key
+uint64_t hashKey(const char* key) {
+    uint64_t hash = 1469598103934665603ull;
+    for (; *key; ++key) {
+        hash ^= (unsigned char)*key;
+        hash *= 1099511628211ull;
     }
-    return true;
+    return hash;
 }
 
-// Insert word into Trie with optional frequency
-void insertWord(TrieNode* root, const char* word, int frequency) {
-    if (!root || !word || !*word) return;
+// Category names; a word's tags are bits indexing this table
+typedef struct {
+    char* names[MAX_TAGS];
+    int count;
+} TagRegistry;
 
-    char* lowerWord = strtolower(word);
-    if (!lowerWord) return;
+TagRegistry tagRegistry = { { NULL }, 0 };
 
-    TrieNode* current = root;
-    for (int i = 0; lowerWord[i]; ++i) {
-        int index = lowerWord[i] - 'a';
-        if (current->children[index] == NULL) {
-            current->children[index] = createTrieNode();
+// Look up a category name, registering it if create is set; -1 if unknown or full
+int lookupTag(const char* name, size_t length, bool create) {
+    for (int i = 0; i < tagRegistry.count; ++i) {
+        if (strlen(tagRegistry.names[i]) == length &&
+            strncasecmp(tagRegistry.names[i], name, length) == 0) {
+            return i;
         }
-        current = current->children[index];
     }
+    if (!create || tagRegistry.count == MAX_TAGS) return -1;
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) return -1;
+    for (size_t i = 0; i < length; ++i) copy[i] = (char)tolower((unsigned char)name[i]);
+    copy[length] = '\0';
+    tagRegistry.names[tagRegistry.count] = copy;
+    return tagRegistry.count++;
+}
 
-    current->isEndOfWord = true;
-    // Only update if new word or higher frequency
-    if (!current->originalWord || frequency > current->frequency) {
-        free(current->originalWord);
-        current->originalWord = strdup(word);
-        current->frequency = frequency;
+// Turn "tag1,tag2" into a bitset; unknown names are registered if create is set
+uint32_t parseTagList(const char* list, bool create) {
+    uint32_t mask = 0;
+    while (*list) {
+        const char* comma = strchr(list, ',');
+        size_t length = comma ? (size_t)(comma - list) : strlen(list);
+        if (length > 0) {
+            int tag = lookupTag(list, length, create);
+            if (tag >= 0) mask |= 1u << tag;
+        }
+        if (!comma) break;
+        list = comma + 1;
     }
-    free(lowerWord);
+    return mask;
+}
+
+// Release the category names
+void freeTagRegistry() {
+    for (int i = 0; i < tagRegistry.count; ++i) {
+        free(tagRegistry.names[i]);
+    }
+    tagRegistry.count = 0;
+}
+
+// Per-query bump arena. Everything a query needs only until its answer is printed
+// (suggestion strings, lowercase copies, DP rows, candidate arrays) is carved from
+// a chain of blocks that is rewound, not freed, as soon as the query is answered.
+typedef struct QueryBlock {
+    struct QueryBlock* next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} QueryBlock;
+
+typedef struct {
+    QueryBlock* first;
+    QueryBlock* current;
+} QueryArena;
+
+// Position to rewind to once a nested scratch allocation is done
+typedef struct {
+    QueryBlock* block;
+    size_t used;
+} QueryMark;
+
+_Thread_local QueryArena queryArena = { NULL, NULL };
+
+// Allocate from the calling thread's arena; memory stays valid until resetQueryArena
+void* queryAlloc(size_t size) {
+    size = (size + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+    QueryBlock* block = queryArena.current;
+    while (block && block->used + size > block->size) {
+        block = block->next;
+        if (block) block->used = 0;
+    }
+    if (!block) {
+        size_t capacity = size > QUERY_BLOCK_SIZE ? size : QUERY_BLOCK_SIZE;
+        block = (QueryBlock*)malloc(sizeof(QueryBlock) + capacity);
+        if (!block) {
+            perror("Failed to allocate query memory");
+            exit(EXIT_FAILURE);
+        }
+        block->size = capacity;
+        block->used = 0;
+        // Splice in after the current block so the blocks it skipped are reused later
+        if (queryArena.current) {
+            block->next = queryArena.current->next;
+            queryArena.current->next = block;
+        } else {
+            block->next = NULL;
+            queryArena.first = block;
+        }
+    }
+    queryArena.current = block;
+    void* memory = (char*)block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+char* queryStrdup(const char* str) {
+    size_t length = strlen(str);
+    char* copy = (char*)queryAlloc(length + 1);
+    memcpy(copy, str, length + 1);
+    return copy;
+}
+
+// Lowercase copy of a string in the query arena
+char* queryLower(const char* str) {
+    size_t length = strlen(str);
+    char* lower = (char*)queryAlloc(length + 1);
+    foldCase(lower, str, length);
+    lower[length] = '\0';
+    return lower;
+}
+
+QueryMark queryArenaMark() {
+    QueryMark mark = { queryArena.current, queryArena.current ? queryArena.current->used : 0 };
+    return mark;
+}
+
+// Give back everything allocated since the mark
+void queryArenaRelease(QueryMark mark) {
+    if (!mark.block) mark.block = queryArena.first;
+    if (!mark.block) return;
+    queryArena.current = mark.block;
+    mark.block->used = mark.used;
+}
+
+// Rewind the arena once a query is answered, keeping its blocks
+void resetQueryArena() {
+    queryArena.current = queryArena.first;
+    if (queryArena.first) queryArena.first->used = 0;
+}
+
+void freeQueryArena() {
+    while (queryArena.first) {
+        QueryBlock* next = queryArena.first->next;
+        free(queryArena.first);
+        queryArena.first = next;
+    }
+    queryArena.current = NULL;
 }
 
-// Initialize suggestion list
-void initSuggestionList(SuggestionList* list) {
+// Initialize suggestion list; a scratch list keeps its words in the query arena
+void initSuggestionList(SuggestionList* list, bool scratch) {
     list->count = 0;
+    list->scratch = scratch;
     for (int i = 0; i < MAX_SUGGESTIONS; ++i) {
         list->suggestions[i].word = NULL;
         list->suggestions[i].distance = INT_MAX;
@@ -112,7 +653,7 @@ void initSuggestionList(SuggestionList* list) {
 // Add suggestion to list if it's better than existing ones
 void addSuggestion(SuggestionList* list, const char* word, int distance, int frequency) {
     if (list->count < MAX_SUGGESTIONS) {
-        list->suggestions[list->count].word = strdup(word);
+        list->suggestions[list->count].word = list->scratch ? queryStrdup(word) : strdup(word);
         list->suggestions[list->count].distance = distance;
         list->suggestions[list->count].frequency = frequency;
         list->count++;
@@ -131,278 +672,4467 @@ void addSuggestion(SuggestionList* list, const char* word, int distance, int fre
         if (distance < list->suggestions[worst_idx].distance ||
             (distance == list->suggestions[worst_idx].distance && 
              frequency > list->suggestions[worst_idx].frequency)) {
-            free(list->suggestions[worst_idx].word);
-            list->suggestions[worst_idx].word = strdup(word);
+            if (!list->scratch) free(list->suggestions[worst_idx].word);
+            list->suggestions[worst_idx].word = list->scratch ? queryStrdup(word) : strdup(word);
             list->suggestions[worst_idx].distance = distance;
             list->suggestions[worst_idx].frequency = frequency;
         }
     }
 }
 
-// Compare function for qsort (prioritize lower distance, then higher frequency)
-int compareSuggestions(const void* a, const void* b) {
-    const Suggestion* sa = (const Suggestion*)a;
-    const Suggestion* sb = (const Suggestion*)b;
-    
-    if (sa->distance != sb->distance) {
-        return sa->distance - sb->distance;
-    }
-    return sb->frequency - sa->frequency;
-}
+// A tracked prefix node: Space-Saving count, overestimation bound and, once the node
+// is provably hot, its materialized top-K completions
+typedef struct {
+    TrieNode* node;
+    int count;
+    int error;
+    SuggestionList* topK;
+} HotPrefix;
 
-// Collect suggestions from Trie with prefix
-void collectSuggestions(TrieNode* node, const char* prefix, SuggestionList* suggestions) {
-    if (!node) return;
+// Space-Saving heavy-hitters summary over queried prefix nodes. Only the
+// HOT_PREFIX_SLOTS most frequent nodes are tracked and only those carry a cache.
+typedef struct {
+    HotPrefix slots[HOT_PREFIX_SLOTS];
+    int used;
+} HotPrefixTracker;
 
-    if (node->isEndOfWord) {
-        addSuggestion(suggestions, node->originalWord, 0, node->frequency);
-    }
+HotPrefixTracker hotPrefixes = { 0 };
 
-    for (int i = 0; i < ALPHABET_SIZE; ++i) {
-        if (node->children[i]) {
-            collectSuggestions(node->children[i], prefix, suggestions);
-        }
+// Find the slot tracking a node
+HotPrefix* findHotPrefix(TrieNode* node) {
+    if (!node->isHotPrefix) return NULL;
+    for (int i = 0; i < hotPrefixes.used; ++i) {
+        if (hotPrefixes.slots[i].node == node) return &hotPrefixes.slots[i];
     }
+    return NULL;
 }
 
-// Search words by prefix
-void searchWordsByPrefix(TrieNode* root, const char* prefix) {
-    if (!root || !prefix) return;
-
-    char* lowerPrefix = strtolower(prefix);
-    if (!lowerPrefix) return;
-
-    TrieNode* current = root;
-    for (int i = 0; lowerPrefix[i]; ++i) {
-        int index = lowerPrefix[i] - 'a';
-        if (!current->children[index]) {
-            free(lowerPrefix);
-            printf("No suggestions found for \"%s\".\n", prefix);
-            return;
-        }
-        current = current->children[index];
+// Drop a slot's cached completions
+void freeCachedTopK(HotPrefix* slot) {
+    if (!slot->topK) return;
+    for (int i = 0; i < slot->topK->count; ++i) {
+        free(slot->topK->suggestions[i].word);
     }
+    free(slot->topK);
+    slot->topK = NULL;
+}
 
-    SuggestionList suggestions;
-    initSuggestionList(&suggestions);
-    collectSuggestions(current, prefix, &suggestions);
-    qsort(suggestions.suggestions, suggestions.count, sizeof(Suggestion), compareSuggestions);
+// Count one query for a prefix node, replacing the minimum slot when the table is full
+HotPrefix* recordPrefixQuery(TrieNode* node) {
+    HotPrefix* slot = findHotPrefix(node);
+    if (slot) {
+        slot->count++;
+        return slot;
+    }
 
-    if (suggestions.count == 0) {
-        printf("No suggestions found for \"%s\".\n", prefix);
+    if (hotPrefixes.used < HOT_PREFIX_SLOTS) {
+        slot = &hotPrefixes.slots[hotPrefixes.used++];
+        slot->count = 1;
+        slot->error = 0;
     } else {
-        printf("Suggestions for \"%s\":\n", prefix);
-        for (int i = 0; i < suggestions.count && i < MAX_SUGGESTIONS; ++i) {
-            printf("%2d. %s (frequency: %d)\n", i+1, suggestions.suggestions[i].word, 
-                   suggestions.suggestions[i].frequency);
+        slot = &hotPrefixes.slots[0];
+        for (int i = 1; i < HOT_PREFIX_SLOTS; ++i) {
+            if (hotPrefixes.slots[i].count < slot->count) slot = &hotPrefixes.slots[i];
         }
+        slot->node->isHotPrefix = false;
+        freeCachedTopK(slot);
+        slot->error = slot->count;
+        slot->count++;
     }
-
-    // Free suggestion strings
-    for (int i = 0; i < suggestions.count; ++i) {
-        free(suggestions.suggestions[i].word);
-    }
-    free(lowerPrefix);
+    slot->node = node;
+    slot->topK = NULL;
+    node->isHotPrefix = true;
+    return slot;
 }
 
-// Levenshtein Distance for Spell Correction
-int levenshteinDistance(const char* s, const char* t) {
-    int lenS = strlen(s), lenT = strlen(t);
-    
-    // Use dynamic memory allocation for larger strings
-    int* prev = (int*)malloc((lenT + 1) * sizeof(int));
-    int* curr = (int*)malloc((lenT + 1) * sizeof(int));
-    
-    if (!prev || !curr) {
-        free(prev);
-        free(curr);
-        return INT_MAX; // Return max distance on allocation failure
-    }
+// Stop tracking a node that is about to be released
+void forgetHotPrefix(TrieNode* node) {
+    HotPrefix* slot = findHotPrefix(node);
+    if (!slot) return;
+    node->isHotPrefix = false;
+    freeCachedTopK(slot);
+    *slot = hotPrefixes.slots[--hotPrefixes.used];
+}
 
-    for (int j = 0; j <= lenT; ++j) prev[j] = j;
+// Discard a node's cache so it is rebuilt on the next query
+void invalidateHotPrefix(TrieNode* node) {
+    HotPrefix* slot = findHotPrefix(node);
+    if (slot) freeCachedTopK(slot);
+}
 
-    for (int i = 1; i <= lenS; ++i) {
-        curr[0] = i;
-        for (int j = 1; j <= lenT; ++j) {
-            int cost = (s[i-1] == t[j-1]) ? 0 : 1;
-            curr[j] = (prev[j] + 1 < curr[j-1] + 1) ? 
-                      (prev[j] + 1 < prev[j-1] + cost ? prev[j] + 1 : prev[j-1] + cost) :
-                      (curr[j-1] + 1 < prev[j-1] + cost ? curr[j-1] + 1 : prev[j-1] + cost);
+// Fold an inserted or re-weighted word into a node's cached completions
+void updateHotPrefix(TrieNode* node, const char* word, int frequency) {
+    HotPrefix* slot = findHotPrefix(node);
+    if (!slot || !slot->topK) return;
+    SuggestionList* list = slot->topK;
+    for (int i = 0; i < list->count; ++i) {
+        if (strcasecmp(list->suggestions[i].word, word) == 0) {
+            char* copy = strdup(word);
+            if (!copy) {
+                freeCachedTopK(slot);
+                return;
+            }
+            free(list->suggestions[i].word);
+            list->suggestions[i].word = copy;
+            list->suggestions[i].frequency = frequency;
+            return;
         }
-        // Swap prev and curr
-        int* temp = prev;
-        prev = curr;
-        curr = temp;
     }
+    addSuggestion(list, word, 0, frequency);
+}
 
-    int result = prev[lenT];
-    free(prev);
-    free(curr);
-    return result;
+// Release every cache
+void freeHotPrefixes() {
+    for (int i = 0; i < hotPrefixes.used; ++i) {
+        freeCachedTopK(&hotPrefixes.slots[i]);
+    }
+    hotPrefixes.used = 0;
 }
 
-// Collect all words in Trie for spell correction
-void collectAllWords(TrieNode* node, Dictionary* dict) {
-    if (!node) return;
+// Bumped on every structural or frequency change so cursors can detect staleness
+unsigned long trieVersion = 0;
 
-    if (node->isEndOfWord && node->originalWord && dict->count < MAX_WORDS) {
-        dict->words[dict->count++] = strdup(node->originalWord);
+// Find the node for a lowercase key, or NULL if the path does not exist
+TrieNode* findNode(TrieNode* root, const char* lowerKey) {
+    TrieNode* current = root;
+    for (int i = 0; current && lowerKey[i]; ++i) {
+        current = childNode(current, lowerKey[i] - 'a');
     }
+    return current;
+}
 
+// Recompute a node's subtree tags, length range and maximum frequency from its own
+// word (which is depth characters long) and its children's summaries
+void refreshSubtreeSummary(TrieNode* node, int depth) {
+    uint32_t tags = 0;
+    int minLength = UINT8_MAX, maxLength = 0, maxFrequency = INT_MIN;
+    if (node->isEndOfWord) {
+        tags = nodePayload(node)->tags;
+        minLength = maxLength = depth;
+        maxFrequency = nodePayload(node)->frequency;
+    }
     for (int i = 0; i < ALPHABET_SIZE; ++i) {
-        if (node->children[i]) {
-            collectAllWords(node->children[i], dict);
-        }
+        TrieNode* child = childNode(node, i);
+        if (!child) continue;
+        const SubtreeSummary* below = nodeSummary(child);
+        tags |= below->tags;
+        if (below->minLength < minLength) minLength = below->minLength;
+        if (below->maxLength > maxLength) maxLength = below->maxLength;
+        if (below->maxFrequency > maxFrequency) maxFrequency = below->maxFrequency;
     }
+    SubtreeSummary* summary = nodeSummary(node);
+    summary->tags = tags;
+    summary->minLength = (uint8_t)minLength;
+    summary->maxLength = (uint8_t)maxLength;
+    summary->maxFrequency = maxFrequency;
 }
 
-// Suggest similar words based on Levenshtein distance
-void suggestSimilarWords(const char* input, Dictionary* dict) {
-    if (!input || !dict || dict->count == 0) return;
-
-    char* lowerInput = strtolower(input);
-    if (!lowerInput) return;
-
-    SuggestionList suggestions;
-    initSuggestionList(&suggestions);
-
-    for (int i = 0; i < dict->count; ++i) {
-        char* lowerDictWord = strtolower(dict->words[i]);
-        if (!lowerDictWord) continue;
+// Fold a word of the given length and frequency into a node's subtree summary
+void extendSubtreeSummary(TrieNode* node, uint32_t tags, int length, int frequency) {
+    SubtreeSummary* summary = nodeSummary(node);
+    summary->tags |= tags;
+    if (length < summary->minLength) summary->minLength = (uint8_t)length;
+    if (length > summary->maxLength) summary->maxLength = (uint8_t)length;
+    if (frequency > summary->maxFrequency) summary->maxFrequency = frequency;
+}
 
-        int distance = levenshteinDistance(lowerInput, lowerDictWord);
-        free(lowerDictWord);
+// Remove a lowercase key and reclaim the nodes that no longer lead to any word
+bool removeWord(TrieNode* root, const char* lowerKey) {
+    int len = strlen(lowerKey);
+    TrieNode** path = (TrieNode**)malloc((len + 1) * sizeof(TrieNode*));
+    if (!path) return false;
 
-        if (distance <= MAX_LEVENSHTEIN_DISTANCE) {
-            // For spell correction, we don't have frequency info, so use 0
-            addSuggestion(&suggestions, dict->words[i], distance, 0);
+    path[0] = root;
+    for (int i = 0; i < len; ++i) {
+        path[i + 1] = childNode(path[i], lowerKey[i] - 'a');
+        if (!path[i + 1]) {
+            free(path);
+            return false;
         }
     }
 
-    qsort(suggestions.suggestions, suggestions.count, sizeof(Suggestion), compareSuggestions);
+    TrieNode* node = path[len];
+    if (!node->isEndOfWord) {
+        free(path);
+        return false;
+    }
+    trieVersion++;
+    node->isEndOfWord = false;
+    NodePayload* payload = nodePayload(node);
+    free(payload->originalWord);
+    payload->originalWord = NULL;
+    payload->frequency = 0;
+    payload->tags = 0;
 
-    if (suggestions.count > 0) {
-        printf("Did you mean:\n");
-        for (int i = 0; i < suggestions.count && i < MAX_SUGGESTIONS; ++i) {
-            printf("%2d. %s (distance: %d)\n", i+1, suggestions.suggestions[i].word, 
-                   suggestions.suggestions[i].distance);
-        }
-    } else {
-        printf("No similar words found.\n");
+    for (int d = 0; d <= len; ++d) {
+        if (path[d]->isHotPrefix) invalidateHotPrefix(path[d]);
     }
 
-    // Free suggestion strings and input copy
-    for (int i = 0; i < suggestions.count; ++i) {
-        free(suggestions.suggestions[i].word);
+    // Rebuild the subtree summaries bottom-up along the path
+    for (int d = len; d >= 0; --d) {
+        refreshSubtreeSummary(path[d], d);
     }
-    free(lowerInput);
-}
 
-// Free Trie memory
-void freeTrie(TrieNode* node) {
-    if (!node) return;
-    for (int i = 0; i < ALPHABET_SIZE; ++i) {
-        freeTrie(node->children[i]);
+    for (int d = len; d > 0; --d) {
+        TrieNode* current = path[d];
+        if (current->isEndOfWord) break;
+        bool hasChildren = false;
+        for (int i = 0; i < ALPHABET_SIZE && !hasChildren; ++i) {
+            hasChildren = current->children[i] != 0;
+        }
+        if (hasChildren) break;
+        setChildNode(path[d - 1], lowerKey[d - 1] - 'a', NULL);
+        if (current->isHotPrefix) forgetHotPrefix(current);
+        releaseTrieNode(current);
     }
-    free(node->originalWord);
-    free(node);
+    free(path);
+    return true;
 }
 
-// Free dictionary memory
-void freeDictionary(Dictionary* dict) {
-    for (int i = 0; i < dict->count; ++i) {
-        free(dict->words[i]);
+// Keys waiting for eviction in one frequency class, oldest first
+typedef struct {
+    char** keys;
+    int head;
+    int count;
+    int capacity;
+} EvictionBucket;
+
+// Byte budget for the trie; words are evicted lowest frequency class first
+typedef struct {
+    size_t limit;        // 0 means unlimited
+    size_t stringBytes;  // original-case words plus eviction keys
+    int evictions;
+    EvictionBucket buckets[FREQUENCY_BUCKETS];
+} MemoryBudget;
+
+MemoryBudget memoryBudget = { 0 };
+
+// Approximate frequency order: floor(log2(frequency)) + 1, with 0 for non-positive
+int frequencyBucket(int frequency) {
+    int bucket = 0;
+    while (frequency > 0 && bucket < FREQUENCY_BUCKETS - 1) {
+        frequency >>= 1;
+        bucket++;
     }
+    return bucket;
 }
 
-// Interactive menu
-void showMenu() {
-    printf("\nMenu:\n");
-    printf("1. Search by prefix\n");
-    printf("2. Show all words\n");
-    printf("3. Exit\n");
-    printf("Choose an option: ");
+// Bytes currently charged against the budget
+size_t memoryInUse() {
+    return nodeArena.nodesInUse * (sizeof(TrieNode) + sizeof(NodePayload) + sizeof(SubtreeSummary)) +
+           memoryBudget.stringBytes;
 }
 
-int main() {
-    TrieNode* root = createTrieNode();
-    Dictionary dict = { .count = 0 };
-    int n;
-
-    printf("Trie-Based Word Suggestion System\n");
-    printf("How many words do you want to enter? (1-%d): ", MAX_WORDS);
-    
-    while (scanf("%d", &n) != 1 || n <= 0 || n > MAX_WORDS) {
-        printf("Invalid input. Enter a number between 1 and %d: ", MAX_WORDS);
-        while (getchar() != '\n'); // Clear input buffer
+// Queue a key for eviction under its frequency class
+void trackWordFrequency(const char* lowerKey, int frequency) {
+    EvictionBucket* bucket = &memoryBudget.buckets[frequencyBucket(frequency)];
+    if (bucket->head + bucket->count == bucket->capacity) {
+        if (bucket->head > 0) {
+            memmove(bucket->keys, bucket->keys + bucket->head, bucket->count * sizeof(char*));
+            bucket->head = 0;
+        } else {
+            int capacity = bucket->capacity ? bucket->capacity * 2 : 16;
+            char** keys = (char**)realloc(bucket->keys, capacity * sizeof(char*));
+            if (!keys) return;
+            bucket->keys = keys;
+            bucket->capacity = capacity;
+        }
     }
+    char* key = strdup(lowerKey);
+    if (!key) return;
+    bucket->keys[bucket->head + bucket->count++] = key;
+    memoryBudget.stringBytes += strlen(key) + 1;
+}
 
-    printf("Enter words (one per line) with optional frequency (word:freq):\n");
-    for (int i = 0; i < n; ) {
-        char input[MAX_WORD_LENGTH * 2]; // Allow space for frequency
-        int frequency = 0;
-        
-        if (scanf("%s", input) != 1) {
-            printf("Error reading input. Try again.\n");
-            while (getchar() != '\n'); // Clear input buffer
+// Evict the lowest-frequency words until the trie fits its budget again.
+// Entries whose word was since removed or moved to another class are stale and dropped.
+void enforceMemoryBudget(TrieNode* root) {
+    int b = 0;
+    while (memoryInUse() > memoryBudget.limit && b < FREQUENCY_BUCKETS) {
+        EvictionBucket* bucket = &memoryBudget.buckets[b];
+        if (bucket->count == 0) {
+            b++;
             continue;
         }
+        char* key = bucket->keys[bucket->head++];
+        bucket->count--;
+        memoryBudget.stringBytes -= strlen(key) + 1;
 
-        // Check for frequency suffix (word:frequency)
-        char* colon = strchr(input, ':');
-        if (colon) {
-            *colon = '\0'; // Split the string
-            frequency = atoi(colon + 1);
+        TrieNode* node = findNode(root, key);
+        if (node && node->isEndOfWord && frequencyBucket(nodePayload(node)->frequency) == b) {
+            memoryBudget.stringBytes -= strlen(nodePayload(node)->originalWord) + 1;
+            removeWord(root, key);
+            memoryBudget.evictions++;
         }
+        free(key);
+    }
+}
 
-        if (strlen(input) >= MAX_WORD_LENGTH || !isValidWord(input)) {
-            printf("Invalid word. Try again.\n");
-            continue;
+// Release the eviction queues
+void freeMemoryBudget() {
+    for (int b = 0; b < FREQUENCY_BUCKETS; ++b) {
+        EvictionBucket* bucket = &memoryBudget.buckets[b];
+        for (int i = 0; i < bucket->count; ++i) {
+            free(bucket->keys[bucket->head + i]);
         }
-
-        insertWord(root, input, frequency);
-        i++;
+        free(bucket->keys);
     }
+    memset(&memoryBudget, 0, sizeof(memoryBudget));
+}
 
-    // Collect all words for spell correction
-    collectAllWords(root, &dict);
+// Insert word into Trie given its already lowercased key; tags are OR-ed into the
+// word's categories, and every node on the path folds the word into its subtree
+// summary (a lower frequency than the stored one never exceeds the summary anyway).
+// The summaries are only extended once the whole path exists, so running out of
+// nodes part way never leaves them advertising a word that is not there.
+void insertNormalizedWord(TrieNode* root, const char* word, const char* lowerWord, int frequency,
+                          uint32_t tags) {
+    int length = strlen(lowerWord);
+    if (length > UINT8_MAX - 1) return;
 
-    int choice;
-    do {
-        showMenu();
-        while (scanf("%d", &choice) != 1) {
-            printf("Invalid input. Enter a number (1-3): ");
-            while (getchar() != '\n');
+    TrieNode* path[UINT8_MAX];
+    TrieNode* current = path[0] = root;
+    bool passedHotPrefix = root->isHotPrefix;
+    trieVersion++;
+    for (int i = 0; lowerWord[i]; ++i) {
+        int index = lowerWord[i] - 'a';
+        if (!current->children[index]) {
+            TrieNode* child = createTrieNode();
+            if (!child) {
+                if (!nodeArena.exhausted) {
+                    fprintf(stderr, "Out of memory for Trie nodes; further new words are skipped.\n");
+                }
+                nodeArena.exhausted = true;
+                return;
+            }
+            setChildNode(current, index, child);
+        }
+        current = path[i + 1] = childNode(current, index);
+        passedHotPrefix = passedHotPrefix || current->isHotPrefix;
+    }
+    for (int i = 0; i <= length; ++i) {
+        extendSubtreeSummary(path[i], tags, length, frequency);
+    }
+
+    current->isEndOfWord = true;
+    NodePayload* payload = nodePayload(current);
+    payload->tags |= tags;
+    // Only update if new word or higher frequency
+    if (!payload->originalWord || frequency > payload->frequency) {
+        if (payload->originalWord) memoryBudget.stringBytes -= strlen(payload->originalWord) + 1;
+        free(payload->originalWord);
+        payload->originalWord = strdup(word);
+        payload->frequency = frequency;
+        if (payload->originalWord) memoryBudget.stringBytes += strlen(payload->originalWord) + 1;
+        if (memoryBudget.limit) trackWordFrequency(lowerWord, frequency);
+
+        // Keep the cached completions of hot prefixes on this path current
+        if (passedHotPrefix && payload->originalWord) {
+            TrieNode* node = root;
+            for (int i = 0; ; ++i) {
+                if (node->isHotPrefix) updateHotPrefix(node, payload->originalWord, frequency);
+                if (!lowerWord[i]) break;
+                node = childNode(node, lowerWord[i] - 'a');
+            }
+        }
+    }
+    if (memoryBudget.limit) enforceMemoryBudget(root);
+}
+
+// Insert word into Trie with optional frequency
+void insertWord(TrieNode* root, const char* word, int frequency) {
+    if (!root || !word || !*word) return;
+
+    char* lowerWord = strtolower(word);
+    if (!lowerWord) return;
+
+    insertNormalizedWord(root, word, lowerWord, frequency, 0);
+    free(lowerWord);
+}
+
+// Compare function for qsort (prioritize lower distance, then higher frequency)
+int compareSuggestions(const void* a, const void* b) {
+    const Suggestion* sa = (const Suggestion*)a;
+    const Suggestion* sb = (const Suggestion*)b;
+    
+    if (sa->distance != sb->distance) {
+        return sa->distance - sb->distance;
+    }
+    return sb->frequency - sa->frequency;
+}
+
+// Visitor results for the traversal engine
+#define TRAVERSE_CONTINUE 0 // descend into the node's children
+#define TRAVERSE_SKIP 1     // do not descend below this node
+#define TRAVERSE_STOP 2     // abort the whole traversal
+
+// Visitor callbacks: enter runs pre-order, leave runs post-order (either may be NULL)
+typedef struct {
+    int (*enter)(TrieNode* node, int depth, char letter, void* ctx);
+    void (*leave)(TrieNode* node, int depth, void* ctx);
+} TrieVisitor;
+
+// Explicit stack frame: the node and the next child slot to visit
+typedef struct {
+    TrieNode* node;
+    int nextChild;
+} TraversalFrame;
+
+// Iterative depth-first traversal in lexicographic order starting at node, which sits
+// at the given depth and was reached via letter. The stack is preallocated for
+// MAX_WORD_LENGTH levels and only moves to the heap for deeper tries.
+// Returns TRAVERSE_STOP if a visitor aborted, TRAVERSE_CONTINUE otherwise.
+int traverseTrie(TrieNode* node, int depth, char letter, const TrieVisitor* visitor, void* ctx) {
+    if (!node) return TRAVERSE_CONTINUE;
+
+    int action = visitor->enter ? visitor->enter(node, depth, letter, ctx) : TRAVERSE_CONTINUE;
+    if (action == TRAVERSE_STOP) return TRAVERSE_STOP;
+    if (action == TRAVERSE_SKIP) {
+        if (visitor->leave) visitor->leave(node, depth, ctx);
+        return TRAVERSE_CONTINUE;
+    }
+
+    TraversalFrame local[MAX_WORD_LENGTH + 1];
+    TraversalFrame* frames = local;
+    int capacity = MAX_WORD_LENGTH + 1;
+    int top = 0;
+    int result = TRAVERSE_CONTINUE;
+
+    frames[0].node = node;
+    frames[0].nextChild = 0;
+
+    while (top >= 0) {
+        TraversalFrame* frame = &frames[top];
+        int i = frame->nextChild;
+        while (i < ALPHABET_SIZE && !frame->node->children[i]) ++i;
+
+        if (i == ALPHABET_SIZE) {
+            if (visitor->leave) visitor->leave(frame->node, depth + top, ctx);
+            --top;
+            continue;
+        }
+
+        TrieNode* child = childNode(frame->node, i);
+        frame->nextChild = i + 1;
+
+        action = visitor->enter ? visitor->enter(child, depth + top + 1, 'a' + i, ctx)
+                                : TRAVERSE_CONTINUE;
+        if (action == TRAVERSE_STOP) {
+            result = TRAVERSE_STOP;
+            break;
+        }
+        if (action == TRAVERSE_SKIP) {
+            if (visitor->leave) visitor->leave(child, depth + top + 1, ctx);
+            continue;
+        }
+
+        if (top + 1 == capacity) {
+            TraversalFrame* grown = (TraversalFrame*)malloc(capacity * 2 * sizeof(TraversalFrame));
+            if (!grown) {
+                perror("Failed to grow traversal stack");
+                exit(EXIT_FAILURE);
+            }
+            memcpy(grown, frames, capacity * sizeof(TraversalFrame));
+            if (frames != local) free(frames);
+            frames = grown;
+            capacity *= 2;
+        }
+        ++top;
+        frames[top].node = child;
+        frames[top].nextChild = 0;
+    }
+
+    if (frames != local) free(frames);
+    return result;
+}
+
+// Frequency a distance-0 suggestion must beat to enter a full list (INT_MIN if not full)
+int suggestionFloor(const SuggestionList* list) {
+    if (list->count < MAX_SUGGESTIONS) return INT_MIN;
+    int floor = INT_MAX;
+    for (int i = 0; i < list->count; ++i) {
+        if (list->suggestions[i].distance > 0) return INT_MIN;
+        if (list->suggestions[i].frequency < floor) floor = list->suggestions[i].frequency;
+    }
+    return floor;
+}
+
+// Visitor: add every terminal to a suggestion list, skipping subtrees whose best
+// frequency cannot displace anything already in a full list
+int enterCollectSuggestion(TrieNode* node, int depth, char letter, void* ctx) {
+    (void)depth;
+    (void)letter;
+    if (nodeSummary(node)->maxFrequency <= suggestionFloor((SuggestionList*)ctx)) return TRAVERSE_SKIP;
+    if (node->isEndOfWord) {
+        const NodePayload* payload = nodePayload(node);
+        addSuggestion((SuggestionList*)ctx, payload->originalWord, 0, payload->frequency);
+    }
+    return TRAVERSE_CONTINUE;
+}
+
+// Collect suggestions from Trie with prefix
+void collectSuggestions(TrieNode* node, const char* prefix, SuggestionList* suggestions) {
+    (void)prefix;
+    TrieVisitor visitor = { enterCollectSuggestion, NULL };
+    traverseTrie(node, 0, '\0', &visitor, suggestions);
+}
+
+// Word demoted to the tail while entering words
+typedef struct {
+    char* word;
+    int frequency;
+} TailEntry;
+
+// Tail file header, stored in the first page
+typedef struct {
+    uint32_t magic;
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint32_t indexBytes; // block index of first keys follows the last block
+} TailHeader;
+
+// Long-tail tier: low-frequency words live in a read-only, page-aligned block file.
+// Each block holds sorted, front-coded entries so one prefix lookup touches the
+// in-memory block index plus one or two pages of the file.
+typedef struct {
+    int hotMinFrequency;  // words below this go to the tail when demoting
+    bool demote;
+    const char* path;
+    TailEntry* pending;
+    int pendingCount;
+    int pendingCapacity;
+    unsigned char* data;
+    size_t size;
+    bool mapped;
+    uint32_t blockCount;
+    const unsigned char** firstKeys; // lowercase first key of each block, into data
+    unsigned char* firstKeyLens;
+} TailTier;
+
+TailTier tailTier = { 0 };
+
+// Queue a word for the tail file
+void demoteToTail(const char* word, int frequency) {
+    if (tailTier.pendingCount == tailTier.pendingCapacity) {
+        int capacity = tailTier.pendingCapacity ? tailTier.pendingCapacity * 2 : 64;
+        TailEntry* grown = (TailEntry*)realloc(tailTier.pending, capacity * sizeof(TailEntry));
+        if (!grown) return;
+        tailTier.pending = grown;
+        tailTier.pendingCapacity = capacity;
+    }
+    char* copy = strdup(word);
+    if (!copy) return;
+    tailTier.pending[tailTier.pendingCount].word = copy;
+    tailTier.pending[tailTier.pendingCount].frequency = frequency;
+    tailTier.pendingCount++;
+}
+
+// Order tail entries by lowercase key, higher frequency first among duplicates
+int compareTailEntries(const void* a, const void* b) {
+    const TailEntry* ea = (const TailEntry*)a;
+    const TailEntry* eb = (const TailEntry*)b;
+    int cmp = strcasecmp(ea->word, eb->word);
+    if (cmp != 0) return cmp;
+    return eb->frequency - ea->frequency;
+}
+
+// Append an unsigned LEB128 varint
+int putVarint(unsigned char* out, uint32_t value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+// Read an unsigned LEB128 varint
+int getVarint(const unsigned char* in, uint32_t* value) {
+    uint32_t result = 0;
+    int shift = 0, n = 0;
+    while (in[n] & 0x80) {
+        result |= (uint32_t)(in[n++] & 0x7F) << shift;
+        shift += 7;
+    }
+    result |= (uint32_t)in[n++] << shift;
+    *value = result;
+    return n;
+}
+
+// Check that a whole varint (at most 5 bytes) starts at in and ends before end
+bool varintFits(const unsigned char* in, const unsigned char* end) {
+    int n = 0;
+    while (n < 5 && in + n < end && (in[n] & 0x80)) n++;
+    return n < 5 && in + n < end;
+}
+
+// Sort, deduplicate and write the pending words as a block file
+bool writeTailFile(const char* path) {
+    qsort(tailTier.pending, tailTier.pendingCount, sizeof(TailEntry), compareTailEntries);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror("Failed to write tail file");
+        return false;
+    }
+
+    unsigned char block[TAIL_BLOCK_SIZE];
+    unsigned char* index = (unsigned char*)malloc(tailTier.pendingCount * (MAX_WORD_LENGTH + 1) + 1);
+    if (!index) {
+        fclose(file);
+        return false;
+    }
+    TailHeader header = { TAIL_MAGIC, TAIL_BLOCK_SIZE, 0, 0 };
+    memset(block, 0, sizeof(block));
+    fwrite(block, 1, TAIL_BLOCK_SIZE, file); // header page, rewritten at the end
+
+    uint16_t entries = 0;
+    size_t pos = sizeof(uint16_t);
+    const char* previous = "";
+
+    for (int i = 0; i <= tailTier.pendingCount; ++i) {
+        const char* word = NULL;
+        if (i < tailTier.pendingCount) {
+            word = tailTier.pending[i].word;
+            // Duplicates sort highest frequency first; keep only that one
+            if (i > 0 && strcasecmp(word, tailTier.pending[i - 1].word) == 0) continue;
+        }
+
+        unsigned char encoded[MAX_WORD_LENGTH + 8];
+        size_t length = 0;
+        int shared = 0;
+        if (word) {
+            int wordLen = strlen(word);
+            if (entries > 0) {
+                while (previous[shared] && previous[shared] == word[shared]) shared++;
+            }
+            encoded[length++] = (unsigned char)shared;
+            encoded[length++] = (unsigned char)(wordLen - shared);
+            memcpy(encoded + length, word + shared, wordLen - shared);
+            length += wordLen - shared;
+            length += putVarint(encoded + length, (uint32_t)tailTier.pending[i].frequency);
+        }
+
+        // Flush the block when the entry does not fit or the input is exhausted
+        if (entries > 0 && (!word || pos + length > TAIL_BLOCK_SIZE)) {
+            memcpy(block, &entries, sizeof(uint16_t));
+            fwrite(block, 1, TAIL_BLOCK_SIZE, file);
+            header.blockCount++;
+            memset(block, 0, sizeof(block));
+            entries = 0;
+            pos = sizeof(uint16_t);
+            if (word) i--; // re-encode as the first entry of the next block
+            continue;
+        }
+        if (!word) break;
+
+        if (entries == 0) {
+            int wordLen = strlen(word);
+            index[header.indexBytes++] = (unsigned char)wordLen;
+            for (int c = 0; c < wordLen; ++c) {
+                index[header.indexBytes++] = (unsigned char)tolower((unsigned char)word[c]);
+            }
+        }
+        memcpy(block + pos, encoded, length);
+        pos += length;
+        entries++;
+        previous = word;
+    }
+
+    fwrite(index, 1, header.indexBytes, file);
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    bool ok = fclose(file) == 0;
+    free(index);
+
+    for (int i = 0; i < tailTier.pendingCount; ++i) {
+        free(tailTier.pending[i].word);
+    }
+    free(tailTier.pending);
+    tailTier.pending = NULL;
+    tailTier.pendingCount = tailTier.pendingCapacity = 0;
+    return ok;
+}
+
+// Check that every entry of a tail block lies inside the block, extends a prefix of
+// the previous word, rebuilds a word shorter than MAX_WORD_LENGTH made of letters,
+// and ends in a varint of at most 5 bytes
+bool validTailBlock(const unsigned char* block) {
+    const unsigned char* end = block + TAIL_BLOCK_SIZE;
+    const unsigned char* cursor = block + sizeof(uint16_t);
+    uint16_t entries;
+    memcpy(&entries, block, sizeof(uint16_t));
+
+    int previousLength = 0;
+    for (uint16_t e = 0; e < entries; ++e) {
+        if (end - cursor < 2) return false;
+        int shared = *cursor++;
+        int suffixLen = *cursor++;
+        if (shared > previousLength || shared + suffixLen >= MAX_WORD_LENGTH || end - cursor < suffixLen) {
+            return false;
+        }
+        for (int c = 0; c < suffixLen; ++c) {
+            if ((unsigned)((cursor[c] | 0x20) - 'a') >= ALPHABET_SIZE) return false;
+        }
+        cursor += suffixLen;
+        if (!varintFits(cursor, end)) return false;
+        uint32_t frequency;
+        cursor += getVarint(cursor, &frequency);
+        previousLength = shared + suffixLen;
+    }
+    return true;
+}
+
+// Map a tail file and load its block index
+bool openTailFile(const char* path) {
+#if defined(__linux__)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < TAIL_BLOCK_SIZE) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    tailTier.data = (unsigned char*)data;
+    tailTier.size = st.st_size;
+    tailTier.mapped = true;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    tailTier.data = (unsigned char*)malloc(size > 0 ? size : 1);
+    if (!tailTier.data || size < TAIL_BLOCK_SIZE || fread(tailTier.data, 1, size, file) != (size_t)size) {
+        fclose(file);
+        free(tailTier.data);
+        tailTier.data = NULL;
+        return false;
+    }
+    fclose(file);
+    tailTier.size = size;
+    tailTier.mapped = false;
+#endif
+
+    TailHeader header;
+    memcpy(&header, tailTier.data, sizeof(header));
+    size_t indexStart = ((size_t)header.blockCount + 1) * TAIL_BLOCK_SIZE;
+    bool valid = header.magic == TAIL_MAGIC && header.blockSize == TAIL_BLOCK_SIZE &&
+                 header.blockCount < tailTier.size / TAIL_BLOCK_SIZE &&
+                 indexStart + header.indexBytes <= tailTier.size;
+    for (uint32_t b = 0; valid && b < header.blockCount; ++b) {
+        valid = validTailBlock(tailTier.data + ((size_t)b + 1) * TAIL_BLOCK_SIZE);
+    }
+    if (!valid) {
+        fprintf(stderr, "Invalid tail file: %s\n", path);
+        return false;
+    }
+
+    tailTier.blockCount = header.blockCount;
+    tailTier.firstKeys = (const unsigned char**)malloc((header.blockCount + 1) * sizeof(unsigned char*));
+    tailTier.firstKeyLens = (unsigned char*)malloc(header.blockCount + 1);
+    if (!tailTier.firstKeys || !tailTier.firstKeyLens) return false;
+
+    const unsigned char* cursor = tailTier.data + indexStart;
+    const unsigned char* indexEnd = cursor + header.indexBytes;
+    for (uint32_t b = 0; b < header.blockCount; ++b) {
+        if (cursor >= indexEnd || indexEnd - (cursor + 1) < *cursor) {
+            fprintf(stderr, "Invalid tail file: %s\n", path);
+            return false;
+        }
+        tailTier.firstKeyLens[b] = *cursor++;
+        tailTier.firstKeys[b] = cursor;
+        cursor += tailTier.firstKeyLens[b];
+    }
+    return true;
+}
+
+// Compare a block's first key against a prefix of length len
+int compareFirstKey(uint32_t block, const char* prefix, int len) {
+    int keyLen = tailTier.firstKeyLens[block];
+    int cmp = memcmp(tailTier.firstKeys[block], prefix, keyLen < len ? keyLen : len);
+    if (cmp != 0) return cmp;
+    return keyLen < len ? -1 : 0;
+}
+
+// Scan the tail for words starting with lowerPrefix that the trie does not already hold,
+// adding them to suggestions. With suggestions == NULL, stops at the first match.
+// Returns the number of matches.
+int scanTail(TrieNode* root, const char* lowerPrefix, SuggestionList* suggestions) {
+    if (!tailTier.data || tailTier.blockCount == 0) return 0;
+    int len = strlen(lowerPrefix);
+
+    // First block whose first key is >= prefix; matches may start in the block before
+    uint32_t lo = 0, hi = tailTier.blockCount;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (compareFirstKey(mid, lowerPrefix, len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    uint32_t block = lo > 0 ? lo - 1 : 0;
+
+    // openTailFile has validated every block, so entries fit these buffers
+    int matches = 0;
+    char word[MAX_WORD_LENGTH], key[MAX_WORD_LENGTH];
+    for (; block < tailTier.blockCount; ++block) {
+        const unsigned char* cursor = tailTier.data + (size_t)(block + 1) * TAIL_BLOCK_SIZE;
+        uint16_t entries;
+        memcpy(&entries, cursor, sizeof(uint16_t));
+        cursor += sizeof(uint16_t);
+
+        for (uint16_t e = 0; e < entries; ++e) {
+            int shared = *cursor++;
+            int suffixLen = *cursor++;
+            for (int c = 0; c < suffixLen; ++c) {
+                word[shared + c] = (char)cursor[c];
+                key[shared + c] = (char)tolower(cursor[c]);
+            }
+            word[shared + suffixLen] = key[shared + suffixLen] = '\0';
+            cursor += suffixLen;
+            uint32_t frequency;
+            cursor += getVarint(cursor, &frequency);
+
+            int cmp = strncmp(key, lowerPrefix, len);
+            if (cmp < 0) continue;
+            if (cmp > 0) return matches;
+            TrieNode* node = findNode(root, key);
+            if (node && node->isEndOfWord) continue;
+            matches++;
+            if (!suggestions) return matches;
+            addSuggestion(suggestions, word, 0, (int)frequency);
+        }
+    }
+    return matches;
+}
+
+// Release the tail mapping and index
+void closeTailFile() {
+#if defined(__linux__)
+    if (tailTier.mapped) munmap(tailTier.data, tailTier.size);
+#endif
+    if (!tailTier.mapped) free(tailTier.data);
+    free(tailTier.firstKeys);
+    free(tailTier.firstKeyLens);
+    tailTier.data = NULL;
+    tailTier.firstKeys = NULL;
+    tailTier.firstKeyLens = NULL;
+    tailTier.blockCount = 0;
+}
+
+// Rank, print and release the completions found for a prefix
+void printPrefixSuggestions(const char* prefix, SuggestionList* suggestions) {
+    qsort(suggestions->suggestions, suggestions->count, sizeof(Suggestion), compareSuggestions);
+
+    if (suggestions->count == 0) {
+        printf("No suggestions found for \"%s\".\n", prefix);
+    } else {
+        printf("Suggestions for \"%s\":\n", prefix);
+        for (int i = 0; i < suggestions->count && i < MAX_SUGGESTIONS; ++i) {
+            printf("%2d. %s (frequency: %d)\n", i+1, suggestions->suggestions[i].word, 
+                   suggestions->suggestions[i].frequency);
+        }
+    }
+
+    suggestions->count = 0;
+}
+
+// Rank and print spelling corrections
+void printSimilarSuggestions(SuggestionList* suggestions) {
+    qsort(suggestions->suggestions, suggestions->count, sizeof(Suggestion), compareSuggestions);
+
+    if (suggestions->count > 0) {
+        printf("Did you mean:\n");
+        for (int i = 0; i < suggestions->count && i < MAX_SUGGESTIONS; ++i) {
+            printf("%2d. %s (distance: %d)\n", i+1, suggestions->suggestions[i].word,
+                   suggestions->suggestions[i].distance);
+        }
+    } else {
+        printf("No similar words found.\n");
+    }
+    suggestions->count = 0;
+}
+
+// Search words by prefix; the on-disk tail is only consulted when the trie
+// cannot fill the suggestion list on its own
+void searchWordsByPrefix(TrieNode* root, const char* prefix) {
+    if (!root || !prefix) return;
+
+    char* lowerPrefix = queryLower(prefix);
+    TrieNode* current = findNode(root, lowerPrefix);
+
+    SuggestionList suggestions;
+    initSuggestionList(&suggestions, true);
+    if (current) {
+        // Hot prefixes answer from their cached top-K instead of enumerating the subtree
+        HotPrefix* hot = recordPrefixQuery(current);
+        if (!hot->topK && hot->count - hot->error >= HOT_PREFIX_MIN_HITS) {
+            hot->topK = (SuggestionList*)malloc(sizeof(SuggestionList));
+            if (hot->topK) {
+                initSuggestionList(hot->topK, false);
+                collectSuggestions(current, prefix, hot->topK);
+            }
+        }
+        if (hot->topK) {
+            for (int i = 0; i < hot->topK->count; ++i) {
+                addSuggestion(&suggestions, hot->topK->suggestions[i].word,
+                              hot->topK->suggestions[i].distance,
+                              hot->topK->suggestions[i].frequency);
+            }
+        } else {
+            collectSuggestions(current, prefix, &suggestions);
+        }
+    }
+    if (suggestions.count < MAX_SUGGESTIONS) {
+        scanTail(root, lowerPrefix, &suggestions);
+    }
+    printPrefixSuggestions(prefix, &suggestions);
+}
+
+// Restrictions for a filtered prefix search
+typedef struct {
+    uint32_t tags;     // words must carry at least one of these categories (0 = any)
+    int maxLength;     // longest acceptable word (0 = any)
+    int minFrequency;  // lowest acceptable frequency (INT_MIN = any)
+} SearchFilter;
+
+// Filtered enumeration state
+typedef struct {
+    const SearchFilter* filter;
+    SuggestionList* suggestions;
+} FilteredCollection;
+
+// Visitor: skip whole subtrees whose summary rules out every word they hold, either
+// by the filter or because nothing in them can displace the current top-K
+int enterCollectFiltered(TrieNode* node, int depth, char letter, void* ctx) {
+    FilteredCollection* collection = (FilteredCollection*)ctx;
+    const SearchFilter* filter = collection->filter;
+    (void)depth;
+    (void)letter;
+    const SubtreeSummary* summary = nodeSummary(node);
+    if (filter->tags && !(summary->tags & filter->tags)) return TRAVERSE_SKIP;
+    if (filter->maxLength && summary->minLength > filter->maxLength) return TRAVERSE_SKIP;
+    if (summary->maxFrequency < filter->minFrequency) return TRAVERSE_SKIP;
+    if (summary->maxFrequency <= suggestionFloor(collection->suggestions)) return TRAVERSE_SKIP;
+
+    if (!node->isEndOfWord) return TRAVERSE_CONTINUE;
+    const NodePayload* payload = nodePayload(node);
+    if ((!filter->tags || (payload->tags & filter->tags)) &&
+        (!filter->maxLength || (int)strlen(payload->originalWord) <= filter->maxLength) &&
+        payload->frequency >= filter->minFrequency) {
+        addSuggestion(collection->suggestions, payload->originalWord, 0, payload->frequency);
+    }
+    return TRAVERSE_CONTINUE;
+}
+
+// Search words by prefix, restricted by the filter; the tail holds no categories
+// and is not consulted
+void searchWordsByPrefixFiltered(TrieNode* root, const char* prefix, const SearchFilter* filter) {
+    char* lowerPrefix = queryLower(prefix);
+
+    SuggestionList suggestions;
+    initSuggestionList(&suggestions, true);
+    FilteredCollection collection = { filter, &suggestions };
+    TrieVisitor visitor = { enterCollectFiltered, NULL };
+    traverseTrie(findNode(root, lowerPrefix), 0, '\0', &visitor, &collection);
+    qsort(suggestions.suggestions, suggestions.count, sizeof(Suggestion), compareSuggestions);
+
+    if (suggestions.count == 0) {
+        printf("No suggestions found for \"%s\" matching those filters.\n", prefix);
+    } else {
+        printf("Suggestions for \"%s\":\n", prefix);
+        for (int i = 0; i < suggestions.count && i < MAX_SUGGESTIONS; ++i) {
+            printf("%2d. %s (frequency: %d)\n", i+1, suggestions.suggestions[i].word,
+                   suggestions.suggestions[i].frequency);
+        }
+    }
+}
+
+// Frontier entry of a best-first completion walk
+typedef struct {
+    TrieNode* node;
+    int key;      // subtree maximum frequency, or the word's own frequency
+    int depth;    // letters below the prefix node
+    bool isWord;
+} FrontierEntry;
+
+// Continuation for paginated completions: the best-first frontier left after the
+// previous page, so later pages never recompute earlier ones. Only valid while the
+// trie is unchanged.
+typedef struct {
+    FrontierEntry* heap;
+    int count;
+    int capacity;
+    unsigned long version;
+} CompletionCursor;
+
+// Push onto the max-heap ordered by key
+void pushFrontier(CompletionCursor* cursor, TrieNode* node, int key, int depth, bool isWord) {
+    if (cursor->count == cursor->capacity) {
+        int capacity = cursor->capacity ? cursor->capacity * 2 : 64;
+        FrontierEntry* heap = (FrontierEntry*)realloc(cursor->heap, capacity * sizeof(FrontierEntry));
+        if (!heap) {
+            perror("Failed to grow completion frontier");
+            exit(EXIT_FAILURE);
+        }
+        cursor->heap = heap;
+        cursor->capacity = capacity;
+    }
+    int i = cursor->count++;
+    while (i > 0 && cursor->heap[(i - 1) / 2].key < key) {
+        cursor->heap[i] = cursor->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    cursor->heap[i].node = node;
+    cursor->heap[i].key = key;
+    cursor->heap[i].depth = depth;
+    cursor->heap[i].isWord = isWord;
+}
+
+// Pop the entry with the highest key
+FrontierEntry popFrontier(CompletionCursor* cursor) {
+    FrontierEntry top = cursor->heap[0];
+    FrontierEntry last = cursor->heap[--cursor->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= cursor->count) break;
+        if (child + 1 < cursor->count && cursor->heap[child + 1].key > cursor->heap[child].key) child++;
+        if (cursor->heap[child].key <= last.key) break;
+        cursor->heap[i] = cursor->heap[child];
+        i = child;
+    }
+    if (cursor->count > 0) cursor->heap[i] = last;
+    return top;
+}
+
+// Start a paginated completion of a lowercase prefix
+void openCompletionCursor(CompletionCursor* cursor, TrieNode* root, const char* lowerPrefix) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->version = trieVersion;
+    TrieNode* start = findNode(root, lowerPrefix);
+    if (start && nodeSummary(start)->maxFrequency != INT_MIN) {
+        pushFrontier(cursor, start, nodeSummary(start)->maxFrequency, 0, false);
+    }
+}
+
+// Expand the frontier until the next completion in descending frequency order is
+// at the top; returns its terminal node, or NULL once the prefix is exhausted
+TrieNode* nextCompletion(CompletionCursor* cursor, int* depth) {
+    while (cursor->count > 0) {
+        FrontierEntry entry = popFrontier(cursor);
+        if (entry.isWord) {
+            *depth = entry.depth;
+            return entry.node;
+        }
+        if (entry.node->isEndOfWord) {
+            pushFrontier(cursor, entry.node, nodePayload(entry.node)->frequency, entry.depth, true);
+        }
+        for (int i = 0; i < ALPHABET_SIZE; ++i) {
+            TrieNode* child = childNode(entry.node, i);
+            if (child && nodeSummary(child)->maxFrequency != INT_MIN) {
+                pushFrontier(cursor, child, nodeSummary(child)->maxFrequency, entry.depth + 1, false);
+            }
+        }
+    }
+    return NULL;
+}
+
+// Produce up to k more completions in descending frequency order. Words point into
+// the trie and are not copied. Returns the number produced, or -1 if the trie has
+// changed since the cursor was opened.
+int nextCompletionPage(CompletionCursor* cursor, Suggestion* out, int k) {
+    if (cursor->version != trieVersion) return -1;
+    int produced = 0;
+    int depth;
+    TrieNode* node;
+    while (produced < k && (node = nextCompletion(cursor, &depth))) {
+        out[produced].word = nodePayload(node)->originalWord;
+        out[produced].distance = 0;
+        out[produced].frequency = nodePayload(node)->frequency;
+        produced++;
+    }
+    return produced;
+}
+
+// Release a cursor's frontier
+void closeCompletionCursor(CompletionCursor* cursor) {
+    free(cursor->heap);
+    memset(cursor, 0, sizeof(*cursor));
+}
+
+// Orders streamCompletions can deliver words in
+#define COMPLETION_LEXICOGRAPHIC 0 // depth-first, by letter
+#define COMPLETION_BEST_FIRST 1    // descending frequency
+
+// Completion callback: the stored word (pointing into the trie, valid until the trie
+// changes), its frequency and its depth below the prefix node. Returns
+// TRAVERSE_STOP to end the stream or TRAVERSE_CONTINUE for more.
+typedef int (*CompletionVisitor)(const char* word, int frequency, int depth, void* ctx);
+
+// Adapter state for the lexicographic stream
+typedef struct {
+    CompletionVisitor visit;
+    void* ctx;
+    int delivered;
+} CompletionStream;
+
+// Visitor: hand each terminal straight to the caller's callback
+int enterStreamCompletion(TrieNode* node, int depth, char letter, void* ctx) {
+    CompletionStream* stream = (CompletionStream*)ctx;
+    (void)letter;
+    if (!node->isEndOfWord) return TRAVERSE_CONTINUE;
+    const NodePayload* payload = nodePayload(node);
+    stream->delivered++;
+    return stream->visit(payload->originalWord, payload->frequency, depth, stream->ctx) == TRAVERSE_STOP
+               ? TRAVERSE_STOP : TRAVERSE_CONTINUE;
+}
+
+// Call visit for every word under a lowercase prefix, in the given order, without
+// copying or collecting them; stops as soon as visit returns TRAVERSE_STOP. Best-first
+// order expands only as much of the subtree as the words delivered so far require.
+// Returns the number of words delivered.
+int streamCompletions(TrieNode* root, const char* lowerPrefix, int order,
+                      CompletionVisitor visit, void* ctx) {
+    if (order == COMPLETION_LEXICOGRAPHIC) {
+        CompletionStream stream = { visit, ctx, 0 };
+        TrieVisitor visitor = { enterStreamCompletion, NULL };
+        traverseTrie(findNode(root, lowerPrefix), 0, '\0', &visitor, &stream);
+        return stream.delivered;
+    }
+
+    CompletionCursor cursor;
+    openCompletionCursor(&cursor, root, lowerPrefix);
+    int delivered = 0;
+    int depth;
+    TrieNode* node;
+    while ((node = nextCompletion(&cursor, &depth))) {
+        const NodePayload* payload = nodePayload(node);
+        delivered++;
+        if (visit(payload->originalWord, payload->frequency, depth, ctx) == TRAVERSE_STOP) break;
+    }
+    closeCompletionCursor(&cursor);
+    return delivered;
+}
+
+// Levenshtein Distance for Spell Correction
+int levenshteinDistance(const char* s, const char* t) {
+    int lenS = strlen(s), lenT = strlen(t);
+    
+    // Both rows come from the query arena and are handed back before returning
+    QueryMark mark = queryArenaMark();
+    int* prev = (int*)queryAlloc((lenT + 1) * sizeof(int));
+    int* curr = (int*)queryAlloc((lenT + 1) * sizeof(int));
+
+    for (int j = 0; j <= lenT; ++j) prev[j] = j;
+
+    for (int i = 1; i <= lenS; ++i) {
+        curr[0] = i;
+        for (int j = 1; j <= lenT; ++j) {
+            int cost = (s[i-1] == t[j-1]) ? 0 : 1;
+            curr[j] = (prev[j] + 1 < curr[j-1] + 1) ? 
+                      (prev[j] + 1 < prev[j-1] + cost ? prev[j] + 1 : prev[j-1] + cost) :
+                      (curr[j-1] + 1 < prev[j-1] + cost ? curr[j-1] + 1 : prev[j-1] + cost);
+        }
+        // Swap prev and curr
+        int* temp = prev;
+        prev = curr;
+        curr = temp;
+    }
+
+    int result = prev[lenT];
+    queryArenaRelease(mark);
+    return result;
+}
+
+// Compute the DP row for appending letter c to a trie path; returns the row minimum
+int computeNextRow(const int* prev, int* curr, char c, const char* input, int inputLen) {
+    curr[0] = prev[0] + 1;
+    int rowMin = curr[0];
+    for (int j = 1; j <= inputLen; ++j) {
+        int cost = (input[j-1] == c) ? 0 : 1;
+        int best = prev[j-1] + cost;
+        if (prev[j] + 1 < best) best = prev[j] + 1;
+        if (curr[j-1] + 1 < best) best = curr[j-1] + 1;
+        curr[j] = best;
+        if (best < rowMin) rowMin = best;
+    }
+    return rowMin;
+}
+
+// State shared by the trie-Levenshtein visitor
+typedef struct {
+    int* rows; // one DP row of inputLen + 1 cells per depth
+    const char* input;
+    int inputLen;
+    SuggestionList* suggestions;
+} FuzzySearch;
+
+// Visitor: extend the DP row for this node, pruning once every cell exceeds the limit
+int enterFuzzyNode(TrieNode* node, int depth, char letter, void* ctx) {
+    FuzzySearch* search = (FuzzySearch*)ctx;
+    const int* prev = search->rows + (depth - 1) * (search->inputLen + 1);
+    int* curr = search->rows + depth * (search->inputLen + 1);
+    int rowMin = computeNextRow(prev, curr, letter, search->input, search->inputLen);
+
+    if (node->isEndOfWord && curr[search->inputLen] <= MAX_LEVENSHTEIN_DISTANCE) {
+        addSuggestion(search->suggestions, nodePayload(node)->originalWord, curr[search->inputLen],
+                      nodePayload(node)->frequency);
+    }
+    if (rowMin > MAX_LEVENSHTEIN_DISTANCE || depth >= MAX_WORD_LENGTH) return TRAVERSE_SKIP;
+    return TRAVERSE_CONTINUE;
+}
+
+// Suggest similar words by resuming from the nodes matched by the exact prefix walk.
+// path[0..matched] holds root and the matched nodes; their DP rows are computed once
+// and the off-path branches are searched from the deepest ancestor upwards.
+void suggestSimilarFromPath(TrieNode** path, int matched, const char* input) {
+    int inputLen = strlen(input);
+    if (matched > inputLen) matched = inputLen;
+
+    int* rows = (int*)queryAlloc((MAX_WORD_LENGTH + 1) * (inputLen + 1) * sizeof(int));
+    int* rowMins = (int*)queryAlloc((matched + 1) * sizeof(int));
+
+    for (int j = 0; j <= inputLen; ++j) rows[j] = j;
+    rowMins[0] = 0;
+    for (int d = 1; d <= matched; ++d) {
+        rowMins[d] = computeNextRow(rows + (d - 1) * (inputLen + 1), rows + d * (inputLen + 1),
+                                    input[d-1], input, inputLen);
+    }
+
+    SuggestionList suggestions;
+    initSuggestionList(&suggestions, true);
+
+    FuzzySearch search = { rows, input, inputLen, &suggestions };
+    TrieVisitor visitor = { enterFuzzyNode, NULL };
+
+    for (int d = matched; d >= 0; --d) {
+        TrieNode* node = path[d];
+        const int* row = rows + d * (inputLen + 1);
+
+        if (node->isEndOfWord && row[inputLen] <= MAX_LEVENSHTEIN_DISTANCE) {
+            addSuggestion(&suggestions, nodePayload(node)->originalWord, row[inputLen],
+                          nodePayload(node)->frequency);
+        }
+        if (rowMins[d] > MAX_LEVENSHTEIN_DISTANCE) continue;
+
+        int onPath = (d < matched) ? input[d] - 'a' : -1;
+        for (int i = 0; i < ALPHABET_SIZE; ++i) {
+            if (i != onPath && node->children[i]) {
+                traverseTrie(childNode(node, i), d + 1, 'a' + i, &visitor, &search);
+            }
+        }
+    }
+
+    printSimilarSuggestions(&suggestions);
+}
+
+// Completion callback: print a numbered word, stopping after MAX_WORDS
+int printListedWord(const char* word, int frequency, int depth, void* ctx) {
+    int* listed = (int*)ctx;
+    (void)frequency;
+    (void)depth;
+    printf("%3d. %s\n", ++*listed, word);
+    return *listed < MAX_WORDS ? TRAVERSE_CONTINUE : TRAVERSE_STOP;
+}
+
+// Flat word table for the linear-scan spell checker. Beside each word it keeps a
+// signature: length, letter-presence mask and a 32-byte letter-count vector, which
+// give cheap lower bounds on the edit distance to any query. Lengths and masks are
+// separate arrays so a block of words can be screened with one vector op per field.
+typedef struct {
+    const char** words;      // original case, pointing into the trie
+    char** lowerWords;
+    int* frequencies;
+    uint8_t* lengths;        // padded by SIGNATURE_BLOCK entries for block loads
+    uint32_t* masks;         // likewise
+    uint8_t (*counts)[32];   // per-letter counts, 26 used, padded for SIMD loads
+    int count;
+    int capacity;
+    unsigned long version;   // trieVersion the table was built from
+    bool built;
+} WordTable;
+
+WordTable wordTable = { 0 };
+
+// Compute a word's signature
+void computeSignature(const char* lowerWord, uint8_t* length, uint32_t* mask, uint8_t counts[32]) {
+    memset(counts, 0, 32);
+    *mask = 0;
+    int n = 0;
+    for (; lowerWord[n]; ++n) {
+        int letter = lowerWord[n] - 'a';
+        *mask |= 1u << letter;
+        if (counts[letter] < UINT8_MAX) counts[letter]++;
+    }
+    *length = (uint8_t)(n < UINT8_MAX ? n : UINT8_MAX);
+}
+
+// Release the table's arrays
+void freeWordTable(WordTable* table) {
+    for (int i = 0; i < table->count; ++i) free(table->lowerWords[i]);
+    free(table->words);
+    free(table->lowerWords);
+    free(table->frequencies);
+    free(table->lengths);
+    free(table->masks);
+    free(table->counts);
+    memset(table, 0, sizeof(*table));
+}
+
+// Visitor: append every terminal and its signature to the table
+int enterTableWord(TrieNode* node, int depth, char letter, void* ctx) {
+    WordTable* table = (WordTable*)ctx;
+    (void)depth;
+    (void)letter;
+    if (!node->isEndOfWord) return TRAVERSE_CONTINUE;
+    const NodePayload* payload = nodePayload(node);
+    if (!payload->originalWord) return TRAVERSE_CONTINUE;
+
+    if (table->count == table->capacity) {
+        int capacity = table->capacity ? table->capacity * 2 : 1024;
+        const char** words = (const char**)realloc(table->words, capacity * sizeof(char*));
+        if (words) table->words = words;
+        char** lowerWords = (char**)realloc(table->lowerWords, capacity * sizeof(char*));
+        if (lowerWords) table->lowerWords = lowerWords;
+        int* frequencies = (int*)realloc(table->frequencies, capacity * sizeof(int));
+        if (frequencies) table->frequencies = frequencies;
+        uint8_t* lengths = (uint8_t*)realloc(table->lengths, capacity + SIGNATURE_BLOCK);
+        if (lengths) table->lengths = lengths;
+        uint32_t* masks = (uint32_t*)realloc(table->masks, (capacity + SIGNATURE_BLOCK) * sizeof(uint32_t));
+        if (masks) table->masks = masks;
+        uint8_t (*counts)[32] = (uint8_t (*)[32])realloc(table->counts, capacity * 32);
+        if (counts) table->counts = counts;
+        if (!words || !lowerWords || !frequencies || !lengths || !masks || !counts) {
+            return TRAVERSE_STOP;
+        }
+        table->capacity = capacity;
+    }
+
+    char* lower = strtolower(payload->originalWord);
+    if (!lower) return TRAVERSE_STOP;
+    int i = table->count++;
+    table->words[i] = payload->originalWord;
+    table->lowerWords[i] = lower;
+    table->frequencies[i] = payload->frequency;
+    computeSignature(lower, &table->lengths[i], &table->masks[i], table->counts[i]);
+    return TRAVERSE_CONTINUE;
+}
+
+// Return the word table for the current trie, rebuilding it if the trie changed
+WordTable* getWordTable(TrieNode* root) {
+    if (wordTable.built && wordTable.version == trieVersion) return &wordTable;
+    freeWordTable(&wordTable);
+    TrieVisitor visitor = { enterTableWord, NULL };
+    traverseTrie(root, 0, '\0', &visitor, &wordTable);
+    wordTable.version = trieVersion;
+    wordTable.built = true;
+    return &wordTable;
+}
+
+// Lower bound on the edit distance from letter counts: every surplus letter on one
+// side needs its own edit, so the distance is at least the larger surplus
+int countLowerBound(const uint8_t a[32], const uint8_t b[32]) {
+#if defined(__AVX2__)
+    __m256i va = _mm256_loadu_si256((const __m256i*)a);
+    __m256i vb = _mm256_loadu_si256((const __m256i*)b);
+    __m256i surplusA = _mm256_sad_epu8(_mm256_subs_epu8(va, vb), _mm256_setzero_si256());
+    __m256i surplusB = _mm256_sad_epu8(_mm256_subs_epu8(vb, va), _mm256_setzero_si256());
+    uint64_t sums[4], sumsB[4];
+    _mm256_storeu_si256((__m256i*)sums, surplusA);
+    _mm256_storeu_si256((__m256i*)sumsB, surplusB);
+    int pos = (int)(sums[0] + sums[1] + sums[2] + sums[3]);
+    int neg = (int)(sumsB[0] + sumsB[1] + sumsB[2] + sumsB[3]);
+#elif defined(__SSE2__)
+    __m128i aLo = _mm_loadu_si128((const __m128i*)a);
+    __m128i aHi = _mm_loadu_si128((const __m128i*)(a + 16));
+    __m128i bLo = _mm_loadu_si128((const __m128i*)b);
+    __m128i bHi = _mm_loadu_si128((const __m128i*)(b + 16));
+    __m128i zero = _mm_setzero_si128();
+    __m128i surplusA = _mm_add_epi64(_mm_sad_epu8(_mm_subs_epu8(aLo, bLo), zero),
+                                     _mm_sad_epu8(_mm_subs_epu8(aHi, bHi), zero));
+    __m128i surplusB = _mm_add_epi64(_mm_sad_epu8(_mm_subs_epu8(bLo, aLo), zero),
+                                     _mm_sad_epu8(_mm_subs_epu8(bHi, aHi), zero));
+    int pos = _mm_cvtsi128_si32(surplusA) + _mm_cvtsi128_si32(_mm_srli_si128(surplusA, 8));
+    int neg = _mm_cvtsi128_si32(surplusB) + _mm_cvtsi128_si32(_mm_srli_si128(surplusB, 8));
+#else
+    int pos = 0, neg = 0;
+    for (int i = 0; i < ALPHABET_SIZE; ++i) {
+        if (a[i] > b[i]) pos += a[i] - b[i];
+        else neg += b[i] - a[i];
+    }
+#endif
+    return pos > neg ? pos : neg;
+}
+
+// Signature screen over SIGNATURE_BLOCK consecutive table entries: bit i is set when
+// entry i is within maxDistance of the input in length and in letters present on one
+// side only. The vector forms compare 16 lengths and 4 or 8 masks per instruction.
+uint32_t screenSignaturesScalar(const uint8_t* lengths, const uint32_t* masks, uint8_t inputLength,
+                                uint32_t inputMask, int maxDistance) {
+    uint32_t pass = 0;
+    for (int i = 0; i < SIGNATURE_BLOCK; ++i) {
+        int lengthGap = lengths[i] - inputLength;
+        if (lengthGap > maxDistance || -lengthGap > maxDistance) continue;
+        if (__builtin_popcount(masks[i] & ~inputMask) > maxDistance ||
+            __builtin_popcount(inputMask & ~masks[i]) > maxDistance) {
+            continue;
+        }
+        pass |= 1u << i;
+    }
+    return pass;
+}
+
+#if defined(__SSE2__)
+// Bit count of each 32-bit lane
+__m128i popcountLanesSse2(__m128i x) {
+    x = _mm_sub_epi32(x, _mm_and_si128(_mm_srli_epi32(x, 1), _mm_set1_epi32(0x55555555)));
+    x = _mm_add_epi32(_mm_and_si128(x, _mm_set1_epi32(0x33333333)),
+                      _mm_and_si128(_mm_srli_epi32(x, 2), _mm_set1_epi32(0x33333333)));
+    x = _mm_and_si128(_mm_add_epi32(x, _mm_srli_epi32(x, 4)), _mm_set1_epi32(0x0F0F0F0F));
+    x = _mm_add_epi32(x, _mm_srli_epi32(x, 8));
+    x = _mm_add_epi32(x, _mm_srli_epi32(x, 16));
+    return _mm_and_si128(x, _mm_set1_epi32(0x3F));
+}
+
+// Lengths as 16 bytes at once: |a - b| from two saturating subtractions
+uint32_t screenLengthsSse2(const uint8_t* lengths, uint8_t inputLength, int maxDistance) {
+    __m128i have = _mm_loadu_si128((const __m128i*)lengths);
+    __m128i want = _mm_set1_epi8((char)inputLength);
+    __m128i gap = _mm_or_si128(_mm_subs_epu8(have, want), _mm_subs_epu8(want, have));
+    __m128i near = _mm_cmpeq_epi8(_mm_min_epu8(gap, _mm_set1_epi8((char)maxDistance)), gap);
+    return (uint32_t)_mm_movemask_epi8(near);
+}
+
+uint32_t screenSignaturesSse2(const uint8_t* lengths, const uint32_t* masks, uint8_t inputLength,
+                              uint32_t inputMask, int maxDistance) {
+    uint32_t pass = screenLengthsSse2(lengths, inputLength, maxDistance);
+    __m128i input = _mm_set1_epi32((int)inputMask);
+    __m128i limit = _mm_set1_epi32(maxDistance);
+    for (int i = 0; i < SIGNATURE_BLOCK; i += 4) {
+        __m128i mask = _mm_loadu_si128((const __m128i*)(masks + i));
+        __m128i extra = popcountLanesSse2(_mm_andnot_si128(input, mask));
+        __m128i missing = popcountLanesSse2(_mm_andnot_si128(mask, input));
+        __m128i far = _mm_or_si128(_mm_cmpgt_epi32(extra, limit), _mm_cmpgt_epi32(missing, limit));
+        pass &= ~((uint32_t)_mm_movemask_ps(_mm_castsi128_ps(far)) << i);
+    }
+    return pass;
+}
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+__attribute__((target("avx2")))
+__m256i popcountLanesAvx2(__m256i x) {
+    x = _mm256_sub_epi32(x, _mm256_and_si256(_mm256_srli_epi32(x, 1), _mm256_set1_epi32(0x55555555)));
+    x = _mm256_add_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x33333333)),
+                         _mm256_and_si256(_mm256_srli_epi32(x, 2), _mm256_set1_epi32(0x33333333)));
+    x = _mm256_and_si256(_mm256_add_epi32(x, _mm256_srli_epi32(x, 4)), _mm256_set1_epi32(0x0F0F0F0F));
+    x = _mm256_add_epi32(x, _mm256_srli_epi32(x, 8));
+    x = _mm256_add_epi32(x, _mm256_srli_epi32(x, 16));
+    return _mm256_and_si256(x, _mm256_set1_epi32(0x3F));
+}
+
+// The masks 8 at a time; the 16 lengths still fit one 128-bit compare
+__attribute__((target("avx2")))
+uint32_t screenSignaturesAvx2(const uint8_t* lengths, const uint32_t* masks, uint8_t inputLength,
+                              uint32_t inputMask, int maxDistance) {
+    __m128i have = _mm_loadu_si128((const __m128i*)lengths);
+    __m128i want = _mm_set1_epi8((char)inputLength);
+    __m128i gap = _mm_or_si128(_mm_subs_epu8(have, want), _mm_subs_epu8(want, have));
+    __m128i near = _mm_cmpeq_epi8(_mm_min_epu8(gap, _mm_set1_epi8((char)maxDistance)), gap);
+    uint32_t pass = (uint32_t)_mm_movemask_epi8(near);
+
+    __m256i input = _mm256_set1_epi32((int)inputMask);
+    __m256i limit = _mm256_set1_epi32(maxDistance);
+    for (int i = 0; i < SIGNATURE_BLOCK; i += 8) {
+        __m256i mask = _mm256_loadu_si256((const __m256i*)(masks + i));
+        __m256i extra = popcountLanesAvx2(_mm256_andnot_si256(input, mask));
+        __m256i missing = popcountLanesAvx2(_mm256_andnot_si256(mask, input));
+        __m256i far = _mm256_or_si256(_mm256_cmpgt_epi32(extra, limit), _mm256_cmpgt_epi32(missing, limit));
+        pass &= ~((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(far)) << i);
+    }
+    return pass;
+}
+#endif
+
+#if defined(__SSE2__)
+uint32_t (*screenSignatures)(const uint8_t*, const uint32_t*, uint8_t, uint32_t, int) = screenSignaturesSse2;
+#else
+uint32_t (*screenSignatures)(const uint8_t*, const uint32_t*, uint8_t, uint32_t, int) = screenSignaturesScalar;
+#endif
+
+// Minimal perfect hash over the word table (hash and displace). Keys are split into
+// buckets, and each bucket, largest first, takes the first seed that sends all of its
+// keys to free slots; single-key buckets just record a free slot. A word's slot is its
+// id, so an exact lookup is one hash, one slot and a fingerprint check.
+typedef struct {
+    uint32_t* seeds;         // per bucket
+    uint32_t* slotWords;     // word table index held by each slot
+    uint32_t* fingerprints;  // low hash bits of the word in each slot
+    uint32_t bucketCount;
+    uint32_t size;
+    unsigned long version;
+    bool built;
+} PerfectHash;
+
+PerfectHash perfectHash = { 0 };
+
+// Slot of a key hash under a bucket seed
+uint32_t perfectHashSlot(uint64_t hash, uint32_t seed, uint32_t size) {
+    uint64_t x = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return (uint32_t)(((x >> 32) * size) >> 32);
+}
+
+// Release the hash
+void freePerfectHash(PerfectHash* ph) {
+    free(ph->seeds);
+    free(ph->slotWords);
+    free(ph->fingerprints);
+    memset(ph, 0, sizeof(*ph));
+}
+
+// Build the hash for every word in the table; false if out of memory or no seed fits
+bool buildPerfectHash(PerfectHash* ph, const WordTable* table) {
+    freePerfectHash(ph);
+    uint32_t n = (uint32_t)table->count;
+    uint32_t bucketCount = n / PERFECT_HASH_BUCKET_SIZE + 1;
+    uint64_t* hashes = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    uint32_t* bucketStart = (uint32_t*)calloc(bucketCount + 1, sizeof(uint32_t));
+    uint32_t* keys = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    uint32_t* order = (uint32_t*)malloc(bucketCount * sizeof(uint32_t));
+    uint8_t* taken = (uint8_t*)calloc(n + 1, 1);
+    ph->seeds = (uint32_t*)calloc(bucketCount, sizeof(uint32_t));
+    ph->slotWords = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    ph->fingerprints = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    bool ok = hashes && bucketStart && keys && order && taken && ph->seeds && ph->slotWords &&
+              ph->fingerprints;
+
+    if (ok) {
+        // Group keys by bucket, then order the buckets by size, largest first
+        for (uint32_t i = 0; i < n; ++i) {
+            hashes[i] = hashKey(table->lowerWords[i]);
+            bucketStart[(uint32_t)(hashes[i] >> 32) % bucketCount + 1]++;
+        }
+        uint32_t largest = 0;
+        for (uint32_t b = 0; b < bucketCount; ++b) {
+            if (bucketStart[b + 1] > largest) largest = bucketStart[b + 1];
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        uint32_t* fill = order; // reused as the fill cursor before it holds the order
+        for (uint32_t b = 0; b < bucketCount; ++b) fill[b] = bucketStart[b];
+        for (uint32_t i = 0; i < n; ++i) keys[fill[(uint32_t)(hashes[i] >> 32) % bucketCount]++] = i;
+        uint32_t sorted = 0;
+        for (uint32_t size = largest; size > 0; --size) {
+            for (uint32_t b = 0; b < bucketCount; ++b) {
+                if (bucketStart[b + 1] - bucketStart[b] == size) order[sorted++] = b;
+            }
+        }
+
+        uint32_t nextFree = 0;
+        uint32_t slots[64];
+        for (uint32_t k = 0; k < sorted && ok; ++k) {
+            uint32_t b = order[k];
+            uint32_t first = bucketStart[b], size = bucketStart[b + 1] - first;
+            if (size == 1) {
+                while (taken[nextFree]) nextFree++;
+                ph->seeds[b] = PERFECT_HASH_DIRECT | nextFree;
+                slots[0] = nextFree;
+            } else if (size > 64) {
+                ok = false;
+                break;
+            } else {
+                uint32_t seed = 0;
+                bool placed = false;
+                while (!placed && seed < PERFECT_HASH_DIRECT - 1) {
+                    placed = true;
+                    seed++;
+                    for (uint32_t j = 0; j < size && placed; ++j) {
+                        slots[j] = perfectHashSlot(hashes[keys[first + j]], seed, n);
+                        if (taken[slots[j]]) placed = false;
+                        for (uint32_t m = 0; m < j && placed; ++m) placed = slots[m] != slots[j];
+                    }
+                }
+                if (!placed) {
+                    ok = false;
+                    break;
+                }
+                ph->seeds[b] = seed;
+            }
+            for (uint32_t j = 0; j < size; ++j) {
+                uint32_t word = keys[first + j];
+                taken[slots[j]] = 1;
+                ph->slotWords[slots[j]] = word;
+                ph->fingerprints[slots[j]] = (uint32_t)hashes[word];
+            }
+        }
+    }
+
+    free(hashes);
+    free(bucketStart);
+    free(keys);
+    free(order);
+    free(taken);
+    if (!ok) {
+        freePerfectHash(ph);
+        return false;
+    }
+    ph->bucketCount = bucketCount;
+    ph->size = n;
+    ph->version = table->version;
+    ph->built = true;
+    return true;
+}
+
+// Return the perfect hash for a word table, rebuilding it if the table changed;
+// NULL if it could not be built
+PerfectHash* getPerfectHash(const WordTable* table) {
+    if (perfectHash.built && perfectHash.version == table->version) return &perfectHash;
+    return buildPerfectHash(&perfectHash, table) ? &perfectHash : NULL;
+}
+
+// Word table index of a lowercase key, or -1 if it is not a word
+int lookupWordId(const PerfectHash* ph, const WordTable* table, const char* lowerKey) {
+    if (ph->size == 0) return -1;
+    uint64_t hash = hashKey(lowerKey);
+    uint32_t seed = ph->seeds[(uint32_t)(hash >> 32) % ph->bucketCount];
+    uint32_t slot = (seed & PERFECT_HASH_DIRECT) ? seed & ~PERFECT_HASH_DIRECT
+                                                 : perfectHashSlot(hash, seed, ph->size);
+    if (ph->fingerprints[slot] != (uint32_t)hash) return -1;
+    uint32_t word = ph->slotWords[slot];
+    return strcmp(table->lowerWords[word], lowerKey) == 0 ? (int)word : -1;
+}
+
+int spellDistance = MAX_LEVENSHTEIN_DISTANCE;
+
+// Bigram inverted index over the word table. Each posting list holds the ids of
+// words containing a bigram, once per occurrence, in blocks of POSTING_BLOCK
+// delta-encoded ids. A block starts with the id before it (4 bytes) and a delta
+// width (1, 2 or 4 bytes), followed by POSTING_BLOCK deltas of that width.
+typedef struct {
+    uint8_t* blob;
+    size_t offsets[GRAM_COUNT];
+    uint32_t lengths[GRAM_COUNT];   // ids in each list
+    unsigned long version;
+    bool built;
+} GramIndex;
+
+GramIndex gramIndex = { 0 };
+
+// Bigram id of two lowercase letters
+int gramId(const char* pair) {
+    return (pair[0] - 'a') * ALPHABET_SIZE + (pair[1] - 'a');
+}
+
+// Release the index
+void freeGramIndex(GramIndex* index) {
+    free(index->blob);
+    memset(index, 0, sizeof(*index));
+}
+
+// Build the index from the word table: count, fill the raw lists, then encode
+void buildGramIndex(GramIndex* index, const WordTable* table) {
+    freeGramIndex(index);
+    size_t starts[GRAM_COUNT + 1] = { 0 };
+    for (int i = 0; i < table->count; ++i) {
+        const char* word = table->lowerWords[i];
+        for (int j = 0; word[j] && word[j+1]; ++j) starts[gramId(word + j) + 1]++;
+    }
+    size_t blobSize = 0;
+    for (int g = 0; g < GRAM_COUNT; ++g) {
+        index->lengths[g] = (uint32_t)starts[g + 1];
+        size_t blocks = (starts[g + 1] + POSTING_BLOCK - 1) / POSTING_BLOCK;
+        blobSize += blocks * (5 + POSTING_BLOCK * 4);
+        starts[g + 1] += starts[g];
+    }
+
+    uint32_t* raw = (uint32_t*)malloc((starts[GRAM_COUNT] + 1) * sizeof(uint32_t));
+    index->blob = (uint8_t*)malloc(blobSize + 1);
+    if (!raw || !index->blob) {
+        free(raw);
+        freeGramIndex(index);
+        return;
+    }
+    size_t fill[GRAM_COUNT];
+    memcpy(fill, starts, sizeof(fill));
+    for (int i = 0; i < table->count; ++i) {
+        const char* word = table->lowerWords[i];
+        for (int j = 0; word[j] && word[j+1]; ++j) raw[fill[gramId(word + j)]++] = (uint32_t)i;
+    }
+
+    // Encode each list, choosing the narrowest delta width per block
+    uint8_t* out = index->blob;
+    for (int g = 0; g < GRAM_COUNT; ++g) {
+        index->offsets[g] = (size_t)(out - index->blob);
+        uint32_t previous = 0;
+        for (size_t b = starts[g]; b < starts[g + 1]; b += POSTING_BLOCK) {
+            size_t end = b + POSTING_BLOCK < starts[g + 1] ? b + POSTING_BLOCK : starts[g + 1];
+            uint32_t maxDelta = 0;
+            for (size_t k = b, last = previous; k < end; last = raw[k++]) {
+                if (raw[k] - last > maxDelta) maxDelta = raw[k] - last;
+            }
+            uint8_t width = maxDelta <= UINT8_MAX ? 1 : maxDelta <= UINT16_MAX ? 2 : 4;
+            memcpy(out, &previous, 4);
+            out[4] = width;
+            out += 5;
+            memset(out, 0, POSTING_BLOCK * width);
+            for (size_t k = b; k < end; ++k) {
+                uint32_t delta = raw[k] - previous;
+                memcpy(out + (k - b) * width, &delta, width);
+                previous = raw[k];
+            }
+            out += POSTING_BLOCK * width;
+        }
+    }
+    free(raw);
+    index->version = table->version;
+    index->built = true;
+}
+
+// Decode one block of POSTING_BLOCK ids; returns the bytes consumed
+size_t decodePostingBlock(const uint8_t* in, uint32_t ids[POSTING_BLOCK]) {
+    uint32_t base;
+    memcpy(&base, in, 4);
+    uint8_t width = in[4];
+    in += 5;
+#if defined(__SSE2__)
+    __m128i lanes[POSTING_BLOCK / 4];
+    __m128i zero = _mm_setzero_si128();
+    if (width == 1) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)in);
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero), hi = _mm_unpackhi_epi8(bytes, zero);
+        lanes[0] = _mm_unpacklo_epi16(lo, zero);
+        lanes[1] = _mm_unpackhi_epi16(lo, zero);
+        lanes[2] = _mm_unpacklo_epi16(hi, zero);
+        lanes[3] = _mm_unpackhi_epi16(hi, zero);
+    } else if (width == 2) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)in);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(in + 16));
+        lanes[0] = _mm_unpacklo_epi16(lo, zero);
+        lanes[1] = _mm_unpackhi_epi16(lo, zero);
+        lanes[2] = _mm_unpacklo_epi16(hi, zero);
+        lanes[3] = _mm_unpackhi_epi16(hi, zero);
+    } else {
+        for (int v = 0; v < POSTING_BLOCK / 4; ++v) lanes[v] = _mm_loadu_si128((const __m128i*)(in + v * 16));
+    }
+    // Prefix-sum the deltas four lanes at a time, carrying the running id
+    __m128i carry = _mm_set1_epi32((int)base);
+    for (int v = 0; v < POSTING_BLOCK / 4; ++v) {
+        __m128i x = lanes[v];
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        _mm_storeu_si128((__m128i*)(ids + v * 4), x);
+        carry = _mm_shuffle_epi32(x, 0xFF);
+    }
+#else
+    for (int k = 0; k < POSTING_BLOCK; ++k) {
+        uint32_t delta = 0;
+        memcpy(&delta, in + k * width, width);
+        base += delta;
+        ids[k] = base;
+    }
+#endif
+    return 5 + (size_t)POSTING_BLOCK * width;
+}
+
+// Collect candidates sharing at least `threshold` bigrams with the input. Lists are
+// merged by counting: every id gets one vote per list it occurs in, capped by how
+// often the input itself contains that bigram.
+int gramCandidates(const GramIndex* index, const char* lowerInput, int threshold,
+                   uint8_t* votes, uint32_t* candidates) {
+    int inputLength = (int)strlen(lowerInput);
+    int queryCounts[GRAM_COUNT] = { 0 };
+    for (int j = 0; j + 1 < inputLength; ++j) queryCounts[gramId(lowerInput + j)]++;
+
+    int found = 0;
+    uint32_t ids[POSTING_BLOCK];
+    for (int g = 0; g < GRAM_COUNT; ++g) {
+        if (queryCounts[g] == 0) continue;
+        const uint8_t* in = index->blob + index->offsets[g];
+        uint32_t previous = UINT32_MAX;
+        int run = 0;
+        for (uint32_t k = 0; k < index->lengths[g]; k += POSTING_BLOCK) {
+            in += decodePostingBlock(in, ids);
+            uint32_t n = index->lengths[g] - k < POSTING_BLOCK ? index->lengths[g] - k : POSTING_BLOCK;
+            for (uint32_t m = 0; m < n; ++m) {
+                uint32_t id = ids[m];
+                run = id == previous ? run + 1 : 1;
+                previous = id;
+                if (run > queryCounts[g]) continue;
+                if (++votes[id] == threshold) candidates[found++] = id;
+            }
+        }
+    }
+    return found;
+}
+
+// Return the bigram index for a word table, rebuilding it if the table changed
+GramIndex* getGramIndex(const WordTable* table) {
+    if (!gramIndex.built || gramIndex.version != table->version) buildGramIndex(&gramIndex, table);
+    return gramIndex.built ? &gramIndex : NULL;
+}
+
+// Suggest words within spellDistance edits. Below MAX_LEVENSHTEIN_DISTANCE, or when
+// the input is too short for the bigram count filter to bite, the word table is
+// scanned and signatures reject most words before the exact kernel runs: length and
+// letters present in only one of the two words are screened a block at a time by
+// screenSignatures, then survivors face the letter-count bound. For larger distances
+// on longer inputs, candidates come from the bigram index: k edits destroy at most
+// 2k of the input's |s|-1 bigrams. Those ids are scattered, so they are screened
+// one at a time.
+void suggestSimilarWords(const char* input, WordTable* table) {
+    if (!input || !table || table->count == 0) return;
+
+    char* lowerInput = queryLower(input);
+
+    uint8_t inputLength;
+    uint32_t inputMask;
+    uint8_t inputCounts[32];
+    computeSignature(lowerInput, &inputLength, &inputMask, inputCounts);
+
+    SuggestionList suggestions;
+    initSuggestionList(&suggestions, true);
+
+    int maxDistance = spellDistance;
+    int threshold = inputLength - 1 - 2 * maxDistance;
+    GramIndex* index = NULL;
+    uint32_t* candidates = NULL;
+    int candidateCount = table->count;
+    if (maxDistance > MAX_LEVENSHTEIN_DISTANCE && threshold > 0 && (index = getGramIndex(table))) {
+        uint8_t* votes = (uint8_t*)queryAlloc(table->count);
+        memset(votes, 0, table->count);
+        candidates = (uint32_t*)queryAlloc(table->count * sizeof(uint32_t));
+        candidateCount = gramCandidates(index, lowerInput, threshold, votes, candidates);
+    }
+
+    for (int c = 0; c < candidateCount; c += candidates ? 1 : SIGNATURE_BLOCK) {
+        uint32_t pass;
+        int base;
+        if (candidates) {
+            base = (int)candidates[c];
+            int lengthGap = table->lengths[base] - inputLength;
+            uint32_t mask = table->masks[base];
+            pass = !(lengthGap > maxDistance || -lengthGap > maxDistance ||
+                     __builtin_popcount(mask & ~inputMask) > maxDistance ||
+                     __builtin_popcount(inputMask & ~mask) > maxDistance);
+        } else {
+            base = c;
+            pass = screenSignatures(table->lengths + c, table->masks + c, inputLength, inputMask, maxDistance);
+            if (candidateCount - c < SIGNATURE_BLOCK) pass &= (1u << (candidateCount - c)) - 1;
+        }
+
+        for (; pass; pass &= pass - 1) {
+            int i = base + __builtin_ctz(pass);
+            if (countLowerBound(table->counts[i], inputCounts) > maxDistance) continue;
+
+            int distance = levenshteinDistance(lowerInput, table->lowerWords[i]);
+            if (distance <= maxDistance) {
+                addSuggestion(&suggestions, table->words[i], distance, table->frequencies[i]);
+            }
+        }
+    }
+
+    printSimilarSuggestions(&suggestions);
+}
+
+// Burst trie backend (--burst-trie). Nodes branch on any byte, so keys may use
+// digits, hyphens, apostrophes and UTF-8 letters. Below a node, sparse subtries are
+// kept as containers: small array hashes whose slots are single byte strings of
+// packed entries, scanned sequentially. A container that outgrows BURST_THRESHOLD
+// bursts into a node with one container per distinct next byte.
+//
+// Container entry layout: suffix length (1 byte), suffix, frequency (4 bytes),
+// original word length (1 byte), original word.
+typedef struct {
+    unsigned char* slots[BURST_SLOTS];
+    uint32_t slotBytes[BURST_SLOTS];
+    int count;
+} BurstContainer;
+
+typedef struct BurstNode {
+    void* children[BURST_FANOUT];          // BurstNode or BurstContainer, see isContainer
+    uint8_t isContainer[BURST_FANOUT / 8];
+    char* originalWord;                    // word ending at this node, if any
+    int frequency;
+} BurstNode;
+
+// One entry decoded from a container slot
+typedef struct {
+    const unsigned char* suffix;
+    int suffixLength;
+    int frequency;
+    const char* word;
+    int wordLength;
+    size_t size;  // bytes the entry occupies
+} BurstEntry;
+
+bool useBurstTrie = false;
+BurstNode* burstRoot = NULL;
+
+// Accept letters, digits, hyphens, apostrophes and any non-ASCII byte
+bool isValidBurstWord(const char* str) {
+    for (; *str; ++str) {
+        unsigned char c = (unsigned char)*str;
+        if (!isalnum(c) && c != '-' && c != '\'' && c < 0x80) return false;
+    }
+    return true;
+}
+
+// Allocate an empty burst node
+BurstNode* createBurstNode() {
+    BurstNode* node = (BurstNode*)calloc(1, sizeof(BurstNode));
+    if (!node) {
+        perror("Failed to create burst trie node");
+        exit(EXIT_FAILURE);
+    }
+    return node;
+}
+
+// Whether a node's child for a byte is a container
+bool burstChildIsContainer(const BurstNode* node, unsigned char c) {
+    return node->isContainer[c >> 3] & (1u << (c & 7));
+}
+
+// Decode the entry starting at p
+BurstEntry readBurstEntry(const unsigned char* p) {
+    BurstEntry entry;
+    entry.suffixLength = p[0];
+    entry.suffix = p + 1;
+    memcpy(&entry.frequency, p + 1 + entry.suffixLength, 4);
+    entry.wordLength = p[5 + entry.suffixLength];
+    entry.word = (const char*)p + 6 + entry.suffixLength;
+    entry.size = 6 + (size_t)entry.suffixLength + entry.wordLength;
+    return entry;
+}
+
+// Slot of a suffix within a container
+uint32_t burstSlot(const unsigned char* suffix, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; ++i) {
+        hash ^= suffix[i];
+        hash *= 16777619u;
+    }
+    return hash % BURST_SLOTS;
+}
+
+// Insert or update a suffix in a container; slots are resized to fit exactly
+void containerInsert(BurstContainer* container, const unsigned char* suffix, int suffixLength,
+                     const char* word, int wordLength, int frequency) {
+    uint32_t slot = burstSlot(suffix, suffixLength);
+    unsigned char* bytes = container->slots[slot];
+    uint32_t used = container->slotBytes[slot];
+    for (uint32_t offset = 0; offset < used; ) {
+        BurstEntry entry = readBurstEntry(bytes + offset);
+        if (entry.suffixLength == suffixLength && memcmp(entry.suffix, suffix, suffixLength) == 0) {
+            if (frequency <= entry.frequency) return;
+            // Drop the old entry; the new one is appended below
+            memmove(bytes + offset, bytes + offset + entry.size, used - offset - entry.size);
+            used -= (uint32_t)entry.size;
+            container->count--;
+            break;
+        }
+        offset += (uint32_t)entry.size;
+    }
+
+    size_t size = 6 + (size_t)suffixLength + wordLength;
+    unsigned char* grown = (unsigned char*)realloc(bytes, used + size);
+    if (!grown) {
+        perror("Failed to grow burst trie container");
+        exit(EXIT_FAILURE);
+    }
+    unsigned char* p = grown + used;
+    p[0] = (unsigned char)suffixLength;
+    memcpy(p + 1, suffix, suffixLength);
+    memcpy(p + 1 + suffixLength, &frequency, 4);
+    p[5 + suffixLength] = (unsigned char)wordLength;
+    memcpy(p + 6 + suffixLength, word, wordLength);
+    container->slots[slot] = grown;
+    container->slotBytes[slot] = used + (uint32_t)size;
+    container->count++;
+}
+
+// Release a container and its slots
+void freeBurstContainer(BurstContainer* container) {
+    for (int i = 0; i < BURST_SLOTS; ++i) free(container->slots[i]);
+    free(container);
+}
+
+// Set a node's word if it is new or more frequent
+void setBurstNodeWord(BurstNode* node, const char* word, int wordLength, int frequency) {
+    if (node->originalWord && frequency <= node->frequency) return;
+    free(node->originalWord);
+    node->originalWord = strndup(word, wordLength);
+    node->frequency = frequency;
+}
+
+// Container for a byte below a node, creating it if the child is empty
+BurstContainer* burstChildContainer(BurstNode* node, unsigned char c) {
+    if (!node->children[c]) {
+        node->children[c] = calloc(1, sizeof(BurstContainer));
+        if (!node->children[c]) {
+            perror("Failed to create burst trie container");
+            exit(EXIT_FAILURE);
+        }
+        node->isContainer[c >> 3] |= 1u << (c & 7);
+    }
+    return (BurstContainer*)node->children[c];
+}
+
+// Replace an overfull container with a node whose children split its entries by
+// their first byte; children that are still overfull burst in turn
+BurstNode* burstContainer(BurstContainer* container) {
+    BurstNode* node = createBurstNode();
+    for (int i = 0; i < BURST_SLOTS; ++i) {
+        for (uint32_t offset = 0; offset < container->slotBytes[i]; ) {
+            BurstEntry entry = readBurstEntry(container->slots[i] + offset);
+            if (entry.suffixLength == 0) {
+                setBurstNodeWord(node, entry.word, entry.wordLength, entry.frequency);
+            } else {
+                containerInsert(burstChildContainer(node, entry.suffix[0]), entry.suffix + 1,
+                                entry.suffixLength - 1, entry.word, entry.wordLength, entry.frequency);
+            }
+            offset += (uint32_t)entry.size;
+        }
+    }
+    freeBurstContainer(container);
+    for (int c = 0; c < BURST_FANOUT; ++c) {
+        BurstContainer* child = (BurstContainer*)node->children[c];
+        if (child && child->count > BURST_THRESHOLD) {
+            node->children[c] = burstContainer(child);
+            node->isContainer[c >> 3] &= ~(1u << (c & 7));
+        }
+    }
+    return node;
+}
+
+// Add a key below a node, following nodes until the key ends or reaches a container
+void burstNodeInsert(BurstNode* node, const unsigned char* key, int keyLength, const char* word,
+                     int wordLength, int frequency) {
+    for (;;) {
+        if (keyLength == 0) {
+            setBurstNodeWord(node, word, wordLength, frequency);
+            return;
+        }
+        unsigned char c = key[0];
+        if (node->children[c] && !burstChildIsContainer(node, c)) {
+            node = (BurstNode*)node->children[c];
+            key++;
+            keyLength--;
+            continue;
+        }
+        BurstContainer* container = burstChildContainer(node, c);
+        containerInsert(container, key + 1, keyLength - 1, word, wordLength, frequency);
+        if (container->count > BURST_THRESHOLD) {
+            node->children[c] = burstContainer(container);
+            node->isContainer[c >> 3] &= ~(1u << (c & 7));
+        }
+        return;
+    }
+}
+
+// Insert a word given its lowercase key
+void burstInsert(const char* word, const char* lowerWord, int frequency) {
+    if (!burstRoot) burstRoot = createBurstNode();
+    int length = (int)strlen(lowerWord);
+    if (length > UINT8_MAX) return;
+    burstNodeInsert(burstRoot, (const unsigned char*)lowerWord, length, word, length, frequency);
+}
+
+// Add every word in a container whose suffix starts with the given bytes
+void collectBurstContainer(const BurstContainer* container, const unsigned char* rest, int restLength,
+                           SuggestionList* list, Dictionary* dict) {
+    char word[UINT8_MAX + 1];
+    for (int i = 0; i < BURST_SLOTS; ++i) {
+        for (uint32_t offset = 0; offset < container->slotBytes[i]; ) {
+            BurstEntry entry = readBurstEntry(container->slots[i] + offset);
+            offset += (uint32_t)entry.size;
+            if (entry.suffixLength < restLength) continue;
+            if (restLength > 0 && memcmp(entry.suffix, rest, restLength) != 0) continue;
+            memcpy(word, entry.word, entry.wordLength);
+            word[entry.wordLength] = '\0';
+            if (list) addSuggestion(list, word, 0, entry.frequency);
+            if (dict && dict->count < MAX_WORDS) dict->words[dict->count++] = queryStrdup(word);
+        }
+    }
+}
+
+// Add every word below a node to a suggestion list or a dictionary
+void collectBurstNode(const BurstNode* node, SuggestionList* list, Dictionary* dict) {
+    if (node->originalWord) {
+        if (list) addSuggestion(list, node->originalWord, 0, node->frequency);
+        if (dict && dict->count < MAX_WORDS) dict->words[dict->count++] = queryStrdup(node->originalWord);
+    }
+    for (int c = 0; c < BURST_FANOUT; ++c) {
+        if (!node->children[c]) continue;
+        if (burstChildIsContainer(node, (unsigned char)c)) {
+            collectBurstContainer((const BurstContainer*)node->children[c], NULL, 0, list, dict);
+        } else {
+            collectBurstNode((const BurstNode*)node->children[c], list, dict);
+        }
+    }
+}
+
+// Top completions of a lowercase prefix
+void burstSearchPrefix(const char* lowerPrefix, SuggestionList* list) {
+    const BurstNode* node = burstRoot;
+    const unsigned char* key = (const unsigned char*)lowerPrefix;
+    while (node) {
+        if (!*key) {
+            collectBurstNode(node, list, NULL);
+            return;
+        }
+        const void* child = node->children[*key];
+        if (!child) return;
+        if (burstChildIsContainer(node, *key)) {
+            collectBurstContainer((const BurstContainer*)child, key + 1, (int)strlen((const char*)key + 1),
+                                  list, NULL);
+            return;
+        }
+        node = (const BurstNode*)child;
+        key++;
+    }
+}
+
+// Fuzzy search state for the burst trie: one DP row per depth
+typedef struct {
+    const char* input;
+    int inputLen;
+    int* rows;
+    SuggestionList* suggestions;
+} BurstFuzzySearch;
+
+// Continue the DP rows through a byte string; returns false once every cell of the
+// last row exceeds the limit
+bool extendBurstRows(BurstFuzzySearch* search, int depth, const unsigned char* bytes, int length) {
+    for (int i = 0; i < length; ++i) {
+        if (depth + i + 1 > UINT8_MAX) return false;
+        const int* prev = search->rows + (depth + i) * (search->inputLen + 1);
+        int* curr = search->rows + (depth + i + 1) * (search->inputLen + 1);
+        int rowMin = computeNextRow(prev, curr, (char)bytes[i], search->input, search->inputLen);
+        if (rowMin > MAX_LEVENSHTEIN_DISTANCE) return false;
+    }
+    return true;
+}
+
+// Walk a node whose DP row for the given depth is filled in
+void burstFuzzyNode(BurstFuzzySearch* search, const BurstNode* node, int depth) {
+    const int* row = search->rows + depth * (search->inputLen + 1);
+    if (node->originalWord && row[search->inputLen] <= MAX_LEVENSHTEIN_DISTANCE) {
+        addSuggestion(search->suggestions, node->originalWord, row[search->inputLen], node->frequency);
+    }
+    char word[UINT8_MAX + 1];
+    for (int c = 0; c < BURST_FANOUT; ++c) {
+        if (!node->children[c]) continue;
+        unsigned char letter = (unsigned char)c;
+        if (!extendBurstRows(search, depth, &letter, 1)) continue;
+        if (!burstChildIsContainer(node, letter)) {
+            burstFuzzyNode(search, (const BurstNode*)node->children[c], depth + 1);
+            continue;
+        }
+        const BurstContainer* container = (const BurstContainer*)node->children[c];
+        for (int i = 0; i < BURST_SLOTS; ++i) {
+            for (uint32_t offset = 0; offset < container->slotBytes[i]; ) {
+                BurstEntry entry = readBurstEntry(container->slots[i] + offset);
+                offset += (uint32_t)entry.size;
+                if (!extendBurstRows(search, depth + 1, entry.suffix, entry.suffixLength)) continue;
+                int distance = search->rows[(depth + 1 + entry.suffixLength) * (search->inputLen + 1) +
+                                            search->inputLen];
+                if (distance > MAX_LEVENSHTEIN_DISTANCE) continue;
+                memcpy(word, entry.word, entry.wordLength);
+                word[entry.wordLength] = '\0';
+                addSuggestion(search->suggestions, word, distance, entry.frequency);
+            }
+        }
+    }
+}
+
+// Words within MAX_LEVENSHTEIN_DISTANCE edits of a lowercase input
+void burstSuggestSimilar(const char* lowerInput, SuggestionList* list) {
+    if (!burstRoot) return;
+    BurstFuzzySearch search = { lowerInput, (int)strlen(lowerInput), NULL, list };
+    search.rows = (int*)queryAlloc((size_t)(UINT8_MAX + 1) * (search.inputLen + 1) * sizeof(int));
+    for (int j = 0; j <= search.inputLen; ++j) search.rows[j] = j;
+    burstFuzzyNode(&search, burstRoot, 0);
+}
+
+// Prefix search on the burst trie, falling back to spell correction like the
+// default backend
+void searchBurstWords(const char* prefix) {
+    if (!isValidBurstWord(prefix)) {
+        printf("Invalid prefix. Only letters, digits, hyphens and apostrophes allowed.\n");
+        return;
+    }
+    char* lowerPrefix = queryLower(prefix);
+    SuggestionList suggestions;
+    initSuggestionList(&suggestions, true);
+    burstSearchPrefix(lowerPrefix, &suggestions);
+    if (suggestions.count > 0) {
+        printPrefixSuggestions(prefix, &suggestions);
+    } else {
+        printf("No words with prefix \"%s\". Trying spell correction...\n", prefix);
+        burstSuggestSimilar(lowerPrefix, &suggestions);
+        printSimilarSuggestions(&suggestions);
+    }
+}
+
+// Release a burst node and everything below it
+void freeBurstNode(BurstNode* node) {
+    if (!node) return;
+    for (int c = 0; c < BURST_FANOUT; ++c) {
+        if (!node->children[c]) continue;
+        if (burstChildIsContainer(node, (unsigned char)c)) {
+            freeBurstContainer((BurstContainer*)node->children[c]);
+        } else {
+            freeBurstNode((BurstNode*)node->children[c]);
+        }
+    }
+    free(node->originalWord);
+    free(node);
+}
+
+// Visitor: release a node once all of its children have been released
+void leaveFreeNode(TrieNode* node, int depth, void* ctx) {
+    (void)depth;
+    (void)ctx;
+    free(nodePayload(node)->originalWord);
+    releaseTrieNode(node);
+}
+
+// Free Trie memory
+void freeTrie(TrieNode* node) {
+    TrieVisitor visitor = { NULL, leaveFreeNode };
+    traverseTrie(node, 0, '\0', &visitor, NULL);
+}
+
+// Add an entered or loaded word, demoting low-frequency untagged words to the tail
+// tier. lowerWord may be NULL when the caller has not normalized the word yet.
+void addWordEntry(TrieNode* root, const char* word, const char* lowerWord, int frequency,
+                  uint32_t tags) {
+    if (useBurstTrie) {
+        char* lower = lowerWord ? NULL : strtolower(word);
+        if (lowerWord || lower) burstInsert(word, lowerWord ? lowerWord : lower, frequency);
+        free(lower);
+    } else if (tailTier.path && tailTier.demote && frequency < tailTier.hotMinFrequency && !tags) {
+        demoteToTail(word, frequency);
+    } else if (lowerWord) {
+        insertNormalizedWord(root, word, lowerWord, frequency, tags);
+    } else {
+        char* lower = strtolower(word);
+        if (!lower) return;
+        insertNormalizedWord(root, word, lower, frequency, tags);
+        free(lower);
+    }
+}
+
+// Read slot: chunk k of the file is always read into slot k % LOAD_SLOTS
+typedef struct {
+    char* buffer;
+    long long offset;
+    size_t length;
+    size_t done;     // bytes already delivered by earlier short reads
+    long bytes;      // result of the read, negative errno on failure
+    bool pending;    // submitted but not yet completed
+    bool ready;      // completed and not yet consumed
+} LoadSlot;
+
+#if defined(__linux__)
+// Minimal io_uring instance driven through the raw system calls
+typedef struct {
+    int fd;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+} IoUring;
+#endif
+
+// Streams a file in order with several reads in flight, via io_uring when the
+// kernel allows it and a small pool of pread threads otherwise
+typedef struct {
+    int fd;
+    long long fileSize;
+    long long nextSeq;     // next chunk handed to the parser
+    LoadSlot slots[LOAD_SLOTS];
+    bool useUring;
+    bool failed;           // a read failed, so the stream ended early
+#if defined(__linux__)
+    IoUring ring;
+    pthread_t workers[LOAD_WORKERS];
+    int workerCount;
+    pthread_mutex_t lock;
+    pthread_cond_t submitted;
+    pthread_cond_t completed;
+    bool stopping;
+#endif
+} AsyncReader;
+
+#if defined(__linux__)
+// Tear down the rings
+void ioUringFree(IoUring* ring) {
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+}
+
+// Set up the submission and completion rings
+bool ioUringInit(IoUring* ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return false;
+
+    ring->fd = fd;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqRingSize > ring->sqRingSize) ring->sqRingSize = ring->cqRingSize;
+        ring->cqRingSize = ring->sqRingSize;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            munmap(ring->sqRing, ring->sqRingSize);
+            close(fd);
+            return false;
+        }
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+        munmap(ring->sqRing, ring->sqRingSize);
+        close(fd);
+        return false;
+    }
+
+    char* sq = (char*)ring->sqRing;
+    char* cq = (char*)ring->cqRing;
+    ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // Kernels before 5.6 have io_uring but neither IORING_OP_READ nor the probe
+    // call; without a confirmed read opcode the pread pool is used instead
+    size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = (struct io_uring_probe*)calloc(1, probeSize);
+    bool canRead = probe && syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                   probe->last_op >= IORING_OP_READ &&
+                   (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    if (!canRead) {
+        ioUringFree(ring);
+        return false;
+    }
+    return true;
+}
+
+// Read length bytes at offset with pread, retrying short reads until EOF; returns
+// the bytes read or a negative errno
+long readFully(int fd, char* buffer, size_t length, long long offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t got = pread(fd, buffer + done, length - done, offset + done);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) return -errno;
+        if (got == 0) break;
+        done += got;
+    }
+    return (long)done;
+}
+
+// Finish a slot synchronously from where its asynchronous reads left off
+void completeSlotSync(int fd, LoadSlot* slot) {
+    long rest = readFully(fd, slot->buffer + slot->done, slot->length - slot->done,
+                          slot->offset + slot->done);
+    slot->bytes = rest < 0 ? rest : (long)(slot->done + rest);
+    slot->pending = false;
+    slot->ready = true;
+}
+
+// Queue and submit a read of the rest of a slot
+bool ioUringSubmitRead(IoUring* ring, int fd, LoadSlot* slot, int slotIndex) {
+    unsigned tail = *ring->sqTail;
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long)(uintptr_t)(slot->buffer + slot->done);
+    sqe->len = (unsigned)(slot->length - slot->done);
+    sqe->off = (unsigned long long)(slot->offset + slot->done);
+    sqe->user_data = (unsigned long long)slotIndex;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    return syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) == 1;
+}
+
+// Block until at least one read completes and mark the completed slots ready. A
+// short read resubmits the remainder; a slot the ring cannot serve (-EINVAL) is
+// finished with pread. Returns false if waiting failed, after failing every slot
+// still pending so no caller waits on them.
+bool ioUringReap(IoUring* ring, int fd, LoadSlot* slots) {
+    unsigned head = *ring->cqHead;
+    while (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR) {
+            long error = -errno;
+            for (int i = 0; i < LOAD_SLOTS; ++i) {
+                if (!slots[i].pending) continue;
+                slots[i].bytes = error;
+                slots[i].pending = false;
+                slots[i].ready = true;
+            }
+            return false;
+        }
+    }
+    while (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+        int index = (int)cqe->user_data;
+        int result = cqe->res;
+        head++;
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+        LoadSlot* slot = &slots[index];
+        if (result == -EINVAL) {
+            completeSlotSync(fd, slot);
+            continue;
+        }
+        if (result > 0) slot->done += (size_t)result;
+        if (result > 0 && slot->done < slot->length) {
+            if (!ioUringSubmitRead(ring, fd, slot, index)) completeSlotSync(fd, slot);
+            continue;
+        }
+        slot->bytes = result < 0 ? result : (long)slot->done;
+        slot->pending = false;
+        slot->ready = true;
+    }
+    return true;
+}
+
+// pread worker: fills any submitted slot that no other worker has claimed
+void* loadWorker(void* arg) {
+    AsyncReader* reader = (AsyncReader*)arg;
+    pthread_mutex_lock(&reader->lock);
+    while (!reader->stopping) {
+        LoadSlot* slot = NULL;
+        for (int i = 0; i < LOAD_SLOTS && !slot; ++i) {
+            if (reader->slots[i].pending) slot = &reader->slots[i];
+        }
+        if (!slot) {
+            pthread_cond_wait(&reader->submitted, &reader->lock);
+            continue;
+        }
+        slot->pending = false; // claimed
+        pthread_mutex_unlock(&reader->lock);
+
+        long result = readFully(reader->fd, slot->buffer, slot->length, slot->offset);
+
+        pthread_mutex_lock(&reader->lock);
+        slot->bytes = result;
+        slot->ready = true;
+        pthread_cond_broadcast(&reader->completed);
+    }
+    pthread_mutex_unlock(&reader->lock);
+    return NULL;
+}
+#endif
+
+// Start the read for chunk seq in its slot, if the chunk lies within the file
+void submitChunk(AsyncReader* reader, long long seq) {
+    long long offset = seq * LOAD_CHUNK_SIZE;
+    if (offset >= reader->fileSize) return;
+
+    int index = (int)(seq % LOAD_SLOTS);
+    LoadSlot* slot = &reader->slots[index];
+    slot->offset = offset;
+    slot->length = reader->fileSize - offset < LOAD_CHUNK_SIZE
+                       ? (size_t)(reader->fileSize - offset) : LOAD_CHUNK_SIZE;
+    slot->done = 0;
+    slot->ready = false;
+#if defined(__linux__)
+    if (reader->useUring) {
+        slot->pending = true;
+        if (!ioUringSubmitRead(&reader->ring, reader->fd, slot, index)) {
+            // Submission failed: read synchronously so the load still completes
+            completeSlotSync(reader->fd, slot);
+        }
+        return;
+    }
+    pthread_mutex_lock(&reader->lock);
+    slot->pending = true;
+    pthread_cond_signal(&reader->submitted);
+    pthread_mutex_unlock(&reader->lock);
+#else
+    FILE* file = (FILE*)(intptr_t)reader->fd;
+    fseek(file, (long)slot->offset, SEEK_SET);
+    slot->bytes = (long)fread(slot->buffer, 1, slot->length, file);
+    slot->ready = true;
+#endif
+}
+
+// Open a file and put the first LOAD_SLOTS chunks in flight
+bool asyncReaderOpen(AsyncReader* reader, const char* path) {
+    memset(reader, 0, sizeof(*reader));
+#if defined(__linux__)
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0) return false;
+    struct stat st;
+    if (fstat(reader->fd, &st) != 0) {
+        close(reader->fd);
+        return false;
+    }
+    reader->fileSize = st.st_size;
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(reader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    reader->fileSize = ftell(file);
+    reader->fd = (int)(intptr_t)file;
+#endif
+
+    for (int i = 0; i < LOAD_SLOTS; ++i) {
+        reader->slots[i].buffer = (char*)malloc(LOAD_CHUNK_SIZE);
+        if (!reader->slots[i].buffer) {
+            perror("Failed to allocate load buffer");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+#if defined(__linux__)
+    reader->useUring = ioUringInit(&reader->ring, LOAD_SLOTS);
+    if (!reader->useUring) {
+        pthread_mutex_init(&reader->lock, NULL);
+        pthread_cond_init(&reader->submitted, NULL);
+        pthread_cond_init(&reader->completed, NULL);
+        for (int i = 0; i < LOAD_WORKERS; ++i) {
+            if (pthread_create(&reader->workers[i], NULL, loadWorker, reader) == 0) {
+                reader->workerCount++;
+            }
+        }
+    }
+#endif
+
+    for (int i = 0; i < LOAD_SLOTS; ++i) {
+        submitChunk(reader, i);
+    }
+    return true;
+}
+
+// Hand out the next chunk in file order; the previous chunk's slot is reused.
+// Returns false at end of file or on a read error.
+bool asyncReaderNext(AsyncReader* reader, const char** data, size_t* length) {
+    if (reader->nextSeq > 0) {
+        submitChunk(reader, reader->nextSeq - 1 + LOAD_SLOTS);
+    }
+    if (reader->nextSeq * LOAD_CHUNK_SIZE >= reader->fileSize) return false;
+
+    LoadSlot* slot = &reader->slots[reader->nextSeq % LOAD_SLOTS];
+#if defined(__linux__)
+    if (reader->useUring) {
+        while (!slot->ready) ioUringReap(&reader->ring, reader->fd, reader->slots);
+    } else if (reader->workerCount == 0) {
+        completeSlotSync(reader->fd, slot);
+    } else {
+        pthread_mutex_lock(&reader->lock);
+        while (!slot->ready) pthread_cond_wait(&reader->completed, &reader->lock);
+        pthread_mutex_unlock(&reader->lock);
+    }
+#endif
+    if (slot->bytes < 0) {
+        errno = (int)-slot->bytes;
+        perror("Failed to read dictionary");
+        reader->failed = true;
+        return false;
+    }
+    if (slot->bytes == 0) return false;
+
+    slot->ready = false;
+    *data = slot->buffer;
+    *length = (size_t)slot->bytes;
+    reader->nextSeq++;
+    return true;
+}
+
+// Stop the workers or ring and release the buffers
+void asyncReaderClose(AsyncReader* reader) {
+#if defined(__linux__)
+    if (reader->useUring) {
+        // Drain reads still in flight before their buffers go away
+        bool inFlight = true;
+        while (inFlight) {
+            inFlight = false;
+            for (int i = 0; i < LOAD_SLOTS; ++i) inFlight = inFlight || reader->slots[i].pending;
+            if (inFlight) ioUringReap(&reader->ring, reader->fd, reader->slots);
+        }
+        ioUringFree(&reader->ring);
+    } else {
+        pthread_mutex_lock(&reader->lock);
+        reader->stopping = true;
+        pthread_cond_broadcast(&reader->submitted);
+        pthread_mutex_unlock(&reader->lock);
+        for (int i = 0; i < reader->workerCount; ++i) {
+            pthread_join(reader->workers[i], NULL);
+        }
+        pthread_mutex_destroy(&reader->lock);
+        pthread_cond_destroy(&reader->submitted);
+        pthread_cond_destroy(&reader->completed);
+    }
+    close(reader->fd);
+#else
+    fclose((FILE*)(intptr_t)reader->fd);
+#endif
+    for (int i = 0; i < LOAD_SLOTS; ++i) {
+        free(reader->slots[i].buffer);
+    }
+}
+
+// Count-min sketch over query strings: fixed memory regardless of how many distinct
+// (mostly junk) strings the logs contain. Strings are promoted into the trie once
+// their estimated count reaches the threshold.
+typedef struct {
+    uint32_t* counters;   // SKETCH_DEPTH rows of width counters
+    uint32_t width;       // power of two
+    uint32_t threshold;
+    unsigned long long observed;
+    int promoted;
+} FrequencySketch;
+
+FrequencySketch querySketch = { NULL, SKETCH_DEFAULT_WIDTH, SKETCH_DEFAULT_THRESHOLD, 0, 0 };
+
+// Allocate the sketch rows, rounding the width up to a power of two
+bool initFrequencySketch(FrequencySketch* sketch) {
+    uint32_t width = 1;
+    while (width < sketch->width && width < (1u << 30)) width <<= 1;
+    sketch->width = width;
+    sketch->counters = (uint32_t*)calloc((size_t)SKETCH_DEPTH * width, sizeof(uint32_t));
+    return sketch->counters != NULL;
+}
+
+// Add count to a key with conservative update: each row is raised only as far as
+// the new minimum estimate, which keeps overestimation from colliding keys low.
+// Returns the key's estimated count after the update.
+uint32_t sketchAdd(FrequencySketch* sketch, const char* lowerKey, uint32_t count) {
+    uint64_t hash = hashKey(lowerKey);
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    uint32_t* cells[SKETCH_DEPTH];
+    uint32_t estimate = UINT32_MAX;
+
+    for (int row = 0; row < SKETCH_DEPTH; ++row) {
+        uint32_t column = (h1 + row * h2) & (sketch->width - 1);
+        cells[row] = &sketch->counters[(size_t)row * sketch->width + column];
+        if (*cells[row] < estimate) estimate = *cells[row];
+    }
+    uint32_t updated = (estimate > UINT32_MAX - count) ? UINT32_MAX : estimate + count;
+    for (int row = 0; row < SKETCH_DEPTH; ++row) {
+        if (*cells[row] < updated) *cells[row] = updated;
+    }
+    sketch->observed += count;
+    return updated;
+}
+
+// Feed one observed query through the sketch; at or above the threshold the word is
+// inserted (or its frequency raised) with the estimated count as its frequency
+void observeQuery(TrieNode* root, const char* word, const char* lowerWord, int count) {
+    uint32_t estimate = sketchAdd(&querySketch, lowerWord, count > 0 ? (uint32_t)count : 1);
+    if (estimate < querySketch.threshold) return;
+
+    TrieNode* node = findNode(root, lowerWord);
+    bool known = node && node->isEndOfWord;
+    if (known && nodePayload(node)->frequency >= (int)(estimate > INT_MAX ? INT_MAX : estimate)) return;
+    insertNormalizedWord(root, word, lowerWord, estimate > INT_MAX ? INT_MAX : (int)estimate, 0);
+    if (!known) querySketch.promoted++;
+}
+
+// Parse a whole field as a base-10 int; false if it is empty, holds anything but
+// an optional sign and digits, or does not fit in an int
+bool parseInteger(const char* text, size_t length, int* value) {
+    size_t i = 0;
+    bool negative = false;
+    if (length > 0 && (text[0] == '+' || text[0] == '-')) negative = text[i++] == '-';
+    if (i == length) return false;
+
+    long long limit = negative ? -(long long)INT_MIN : INT_MAX;
+    long long result = 0;
+    for (; i < length; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        result = result * 10 + (text[i] - '0');
+        if (result > limit) return false;
+    }
+    *value = (int)(negative ? -result : result);
+    return true;
+}
+
+// Parse a command-line value as an int in [minimum, maximum]; value is left alone
+// if the text is not such a number
+bool parseOption(const char* text, int minimum, int maximum, int* value) {
+    int parsed;
+    if (!parseInteger(text, strlen(text), &parsed) || parsed < minimum || parsed > maximum) return false;
+    *value = parsed;
+    return true;
+}
+
+// Split a "word[:frequency[:tag,tag]]" line in place; returns the word, or NULL if
+// it is invalid. A frequency that is not a number in int range counts as 0. New
+// category names are registered as they are seen.
+char* parseDictionaryLine(char* line, size_t length, int* frequency, uint32_t* tags) {
+    if (length > 0 && line[length - 1] == '\r') length--;
+    line[length] = '\0';
+
+    *frequency = 0;
+    *tags = 0;
+    char* colon = memchr(line, ':', length);
+    if (colon) {
+        *colon = '\0';
+        char* field = colon + 1;
+        char* tagList = memchr(field, ':', line + length - field);
+        size_t fieldLength = (tagList ? tagList : line + length) - field;
+        if (!parseInteger(field, fieldLength, frequency)) *frequency = 0;
+        if (tagList) *tags = parseTagList(tagList + 1, true);
+    }
+    if (!*line || strlen(line) >= MAX_WORD_LENGTH) return NULL;
+    if (!(useBurstTrie ? isValidBurstWord(line) : isValidWord(line))) return NULL;
+    return line;
+}
+
+// Words handed between pipeline stages, NUL-terminated back to back
+typedef struct {
+    char* text;
+    char* lower;         // lowercase copy at the same offsets, filled by the normalizer
+    size_t textLength;
+    int offsets[INGEST_BATCH_WORDS];
+    int frequencies[INGEST_BATCH_WORDS];
+    uint32_t tags[INGEST_BATCH_WORDS];
+    int count;
+} IngestBatch;
+
+// A chunk of raw file bytes owned by the parser stage once pushed
+typedef struct {
+    char* data;
+    size_t length;
+} IngestChunk;
+
+// Lock-free single-producer/single-consumer ring of pointers; NULL marks end of stream
+typedef struct {
+    void* items[INGEST_RING_SIZE];
+    char padding0[64];
+    size_t head;                 // written by the consumer only
+    char padding1[64];
+    size_t tail;                 // written by the producer only
+    char padding2[64];
+} SpscRing;
+
+// Throughput counters for one stage
+typedef struct {
+    unsigned long long items;
+    unsigned long long bytes;
+    double seconds;
+} StageCounter;
+
+// Staged ingestion: reader -> parser/validator -> normalizer -> inserter
+typedef struct {
+    TrieNode* root;
+    AsyncReader reader;
+    SpscRing chunks;
+    SpscRing parsed;
+    SpscRing normalized;
+    char carry[MAX_WORD_LENGTH * 2];  // line split across two chunks
+    size_t carryLength;
+    bool carryOverflow;
+    IngestBatch* batch;               // batch being filled by the parser
+    bool parseInline;                 // parser also normalizes and inserts
+    bool normalizeInline;             // normalizer also inserts
+    bool queryLog;                    // lines are query counts for the sketch, not words
+    int loaded;
+    int rejected;
+    StageCounter readStage;
+    StageCounter parseStage;
+    StageCounter normalizeStage;
+    StageCounter insertStage;
+} IngestPipeline;
+
+bool ingestStats = false;
+
+// Monotonic clock in seconds
+double nowSeconds() {
+#if defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// Push, spinning politely while the consumer catches up
+void spscPush(SpscRing* ring, void* item) {
+    size_t tail = ring->tail;
+    while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == INGEST_RING_SIZE) {
+#if defined(__linux__)
+        sched_yield();
+#endif
+    }
+    ring->items[tail % INGEST_RING_SIZE] = item;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Pop, spinning politely while the producer has nothing ready
+void* spscPop(SpscRing* ring) {
+    size_t head = ring->head;
+    while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head) {
+#if defined(__linux__)
+        sched_yield();
+#endif
+    }
+    void* item = ring->items[head % INGEST_RING_SIZE];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return item;
+}
+
+// Allocate an empty batch
+IngestBatch* newIngestBatch() {
+    IngestBatch* batch = (IngestBatch*)malloc(sizeof(IngestBatch));
+    char* text = (char*)malloc(INGEST_BATCH_WORDS * MAX_WORD_LENGTH);
+    if (!batch || !text) {
+        perror("Failed to allocate ingestion batch");
+        exit(EXIT_FAILURE);
+    }
+    batch->text = text;
+    batch->lower = NULL;
+    batch->textLength = 0;
+    batch->count = 0;
+    return batch;
+}
+
+// Release a batch after insertion
+void freeIngestBatch(IngestBatch* batch) {
+    free(batch->text);
+    free(batch->lower);
+    free(batch);
+}
+
+// Lowercase a whole batch into its key buffer
+void normalizeBatch(IngestPipeline* pipeline, IngestBatch* batch) {
+    batch->lower = (char*)malloc(batch->textLength);
+    if (!batch->lower) {
+        perror("Failed to allocate ingestion batch");
+        exit(EXIT_FAILURE);
+    }
+    foldCase(batch->lower, batch->text, batch->textLength);
+    pipeline->normalizeStage.items += batch->count;
+    pipeline->normalizeStage.bytes += batch->textLength;
+}
+
+// Insert a normalized batch and release it
+void insertBatch(IngestPipeline* pipeline, IngestBatch* batch) {
+    for (int i = 0; i < batch->count; ++i) {
+        if (pipeline->queryLog) {
+            observeQuery(pipeline->root, batch->text + batch->offsets[i],
+                         batch->lower + batch->offsets[i], batch->frequencies[i]);
+        } else {
+            addWordEntry(pipeline->root, batch->text + batch->offsets[i],
+                         batch->lower + batch->offsets[i], batch->frequencies[i], batch->tags[i]);
+        }
+    }
+    pipeline->loaded += batch->count;
+    pipeline->insertStage.items += batch->count;
+    pipeline->insertStage.bytes += batch->textLength;
+    freeIngestBatch(batch);
+}
+
+// Hand a full batch to the normalizer, or finish it here when running inline
+void emitParsedBatch(IngestPipeline* pipeline, IngestBatch* batch) {
+    if (pipeline->parseInline) {
+        normalizeBatch(pipeline, batch);
+        insertBatch(pipeline, batch);
+    } else {
+        spscPush(&pipeline->parsed, batch);
+    }
+}
+
+// Validate the carried line and append it to the current batch
+void parseIngestLine(IngestPipeline* pipeline) {
+    if (pipeline->carryOverflow) {
+        pipeline->rejected++;
+    } else if (pipeline->carryLength > 0) {
+        int frequency;
+        uint32_t tags;
+        char* word = parseDictionaryLine(pipeline->carry, pipeline->carryLength, &frequency, &tags);
+        if (!word) {
+            pipeline->rejected++;
+        } else {
+            IngestBatch* batch = pipeline->batch;
+            size_t wordLength = strlen(word) + 1;
+            batch->offsets[batch->count] = (int)batch->textLength;
+            batch->frequencies[batch->count] = frequency;
+            batch->tags[batch->count] = tags;
+            memcpy(batch->text + batch->textLength, word, wordLength);
+            batch->textLength += wordLength;
+            pipeline->parseStage.items++;
+            if (++batch->count == INGEST_BATCH_WORDS) {
+                emitParsedBatch(pipeline, batch);
+                pipeline->batch = newIngestBatch();
+            }
+        }
+    }
+    pipeline->carryLength = 0;
+    pipeline->carryOverflow = false;
+}
+
+// Split a chunk into lines; the last partial line stays in the carry buffer
+void parseChunk(IngestPipeline* pipeline, const char* data, size_t length) {
+    const char* cursor = data;
+    const char* end = data + length;
+    while (cursor < end) {
+        const char* newline = memchr(cursor, '\n', end - cursor);
+        size_t piece = (newline ? newline : end) - cursor;
+        if (pipeline->carryLength + piece < sizeof(pipeline->carry)) {
+            memcpy(pipeline->carry + pipeline->carryLength, cursor, piece);
+            pipeline->carryLength += piece;
+        } else {
+            pipeline->carryOverflow = true;
+        }
+        if (!newline) break;
+        parseIngestLine(pipeline);
+        cursor = newline + 1;
+    }
+    pipeline->parseStage.bytes += length;
+}
+
+// Flush the final line and partial batch
+void finishParsing(IngestPipeline* pipeline) {
+    parseIngestLine(pipeline);
+    if (pipeline->batch->count > 0) {
+        emitParsedBatch(pipeline, pipeline->batch);
+    } else {
+        freeIngestBatch(pipeline->batch);
+    }
+    pipeline->batch = NULL;
+    if (!pipeline->parseInline) spscPush(&pipeline->parsed, NULL);
+}
+
+// Reader stage: copy each chunk out of the async reader's slot
+void runReadStage(IngestPipeline* pipeline) {
+    double start = nowSeconds();
+    const char* data;
+    size_t length;
+    while (asyncReaderNext(&pipeline->reader, &data, &length)) {
+        IngestChunk* chunk = (IngestChunk*)malloc(sizeof(IngestChunk));
+        char* copy = (char*)malloc(length);
+        if (!chunk || !copy) {
+            perror("Failed to allocate ingestion chunk");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(copy, data, length);
+        chunk->data = copy;
+        chunk->length = length;
+        pipeline->readStage.items++;
+        pipeline->readStage.bytes += length;
+        spscPush(&pipeline->chunks, chunk);
+    }
+    spscPush(&pipeline->chunks, NULL);
+    pipeline->readStage.seconds = nowSeconds() - start;
+}
+
+// Parser/validator stage: split chunks into lines and batch the valid words
+void runParseStage(IngestPipeline* pipeline) {
+    double start = nowSeconds();
+    pipeline->batch = newIngestBatch();
+    IngestChunk* chunk;
+    while ((chunk = (IngestChunk*)spscPop(&pipeline->chunks)) != NULL) {
+        parseChunk(pipeline, chunk->data, chunk->length);
+        free(chunk->data);
+        free(chunk);
+    }
+    finishParsing(pipeline);
+    pipeline->parseStage.seconds = nowSeconds() - start;
+}
+
+// Normalizer stage: build the lowercase keys for a whole batch at once
+void runNormalizeStage(IngestPipeline* pipeline) {
+    double start = nowSeconds();
+    IngestBatch* batch;
+    while ((batch = (IngestBatch*)spscPop(&pipeline->parsed)) != NULL) {
+        normalizeBatch(pipeline, batch);
+        if (pipeline->normalizeInline) {
+            insertBatch(pipeline, batch);
+        } else {
+            spscPush(&pipeline->normalized, batch);
+        }
+    }
+    if (!pipeline->normalizeInline) spscPush(&pipeline->normalized, NULL);
+    pipeline->normalizeStage.seconds = nowSeconds() - start;
+}
+
+// Inserter stage: the trie, arena and budget are single-writer, so this runs on
+// the calling thread while the earlier stages run ahead of it
+void runInsertStage(IngestPipeline* pipeline) {
+    double start = nowSeconds();
+    IngestBatch* batch;
+    while ((batch = (IngestBatch*)spscPop(&pipeline->normalized)) != NULL) {
+        insertBatch(pipeline, batch);
+    }
+    pipeline->insertStage.seconds = nowSeconds() - start;
+}
+
+// Run every stage on the calling thread, one chunk at a time
+void runStagesInline(IngestPipeline* pipeline) {
+    double start = nowSeconds();
+    const char* data;
+    size_t length;
+    pipeline->parseInline = true;
+    pipeline->batch = newIngestBatch();
+    while (asyncReaderNext(&pipeline->reader, &data, &length)) {
+        pipeline->readStage.items++;
+        pipeline->readStage.bytes += length;
+        parseChunk(pipeline, data, length);
+    }
+    finishParsing(pipeline);
+    pipeline->insertStage.seconds = nowSeconds() - start;
+}
+
+#if defined(__linux__)
+void* readStageThread(void* arg) {
+    runReadStage((IngestPipeline*)arg);
+    return NULL;
+}
+
+void* parseStageThread(void* arg) {
+    runParseStage((IngestPipeline*)arg);
+    return NULL;
+}
+
+void* normalizeStageThread(void* arg) {
+    runNormalizeStage((IngestPipeline*)arg);
+    return NULL;
+}
+#endif
+
+// Print one stage's counters
+void printStageCounter(const char* name, const StageCounter* counter, const char* unit) {
+    double seconds = counter->seconds > 0 ? counter->seconds : 1e-9;
+    printf("  %-10s %10llu %-6s %8.1f MB %8.3f s %10.0f %s/s %8.1f MB/s\n", name,
+           counter->items, unit, counter->bytes / 1e6, counter->seconds,
+           counter->items / seconds, unit, counter->bytes / 1e6 / seconds);
+}
+
+// Run a file through the staged pipeline. Reader, parser and normalizer each get a
+// thread and the inserter runs here; any stage whose thread cannot be started is
+// folded into the stage that feeds it.
+bool ingestFile(TrieNode* root, const char* path, bool queryLog, int* loaded, int* rejected) {
+    IngestPipeline* pipeline = (IngestPipeline*)calloc(1, sizeof(IngestPipeline));
+    if (!pipeline) return false;
+    pipeline->root = root;
+    pipeline->queryLog = queryLog;
+    if (!asyncReaderOpen(&pipeline->reader, path)) {
+        perror(queryLog ? "Failed to open query log" : "Failed to open dictionary");
+        free(pipeline);
+        return false;
+    }
+
+#if defined(__linux__)
+    pthread_t reader, parser, normalizer;
+    if (pthread_create(&reader, NULL, readStageThread, pipeline) != 0) {
+        runStagesInline(pipeline);
+    } else {
+        if (pthread_create(&parser, NULL, parseStageThread, pipeline) != 0) {
+            pipeline->parseInline = true;
+            runParseStage(pipeline);
+        } else {
+            if (pthread_create(&normalizer, NULL, normalizeStageThread, pipeline) != 0) {
+                pipeline->normalizeInline = true;
+                runNormalizeStage(pipeline);
+            } else {
+                runInsertStage(pipeline);
+                pthread_join(normalizer, NULL);
+            }
+            pthread_join(parser, NULL);
+        }
+        pthread_join(reader, NULL);
+    }
+#else
+    runStagesInline(pipeline);
+#endif
+
+    bool readOk = !pipeline->reader.failed;
+    asyncReaderClose(&pipeline->reader);
+    *loaded = pipeline->loaded;
+    *rejected = pipeline->rejected;
+
+    if (ingestStats) {
+        printf("Ingestion pipeline:\n");
+        printStageCounter("read", &pipeline->readStage, "chunks");
+        printStageCounter("parse", &pipeline->parseStage, "words");
+        printStageCounter("normalize", &pipeline->normalizeStage, "words");
+        printStageCounter("insert", &pipeline->insertStage, "words");
+    }
+    free(pipeline);
+    return readOk;
+}
+
+// Load a word list (one word[:frequency] per line)
+bool loadDictionaryFile(TrieNode* root, const char* path, int* loaded, int* rejected) {
+    return ingestFile(root, path, false, loaded, rejected);
+}
+
+// Stream a query log (one query[:count] per line) through the frequency sketch
+bool loadQueryLog(TrieNode* root, const char* path, int* observed, int* rejected) {
+    if (!querySketch.counters && !initFrequencySketch(&querySketch)) {
+        perror("Failed to allocate frequency sketch");
+        return false;
+    }
+    return ingestFile(root, path, true, observed, rejected);
+}
+
+// Worst-case compressed size for n input bytes
+size_t lzCompressBound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+// Append an LZ sequence: literal run, then an optional back-reference
+size_t lzEmitSequence(unsigned char* out, size_t op, const unsigned char* literals,
+                      size_t literalLength, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+    out[op++] = (unsigned char)(((literalLength < 15 ? literalLength : 15) << 4) |
+                                (matchCode < 15 ? matchCode : 15));
+    if (literalLength >= 15) {
+        size_t rest = literalLength - 15;
+        for (; rest >= 255; rest -= 255) out[op++] = 255;
+        out[op++] = (unsigned char)rest;
+    }
+    memcpy(out + op, literals, literalLength);
+    op += literalLength;
+    if (matchLength) {
+        out[op++] = (unsigned char)(offset & 0xFF);
+        out[op++] = (unsigned char)(offset >> 8);
+        if (matchCode >= 15) {
+            size_t rest = matchCode - 15;
+            for (; rest >= 255; rest -= 255) out[op++] = 255;
+            out[op++] = (unsigned char)rest;
+        }
+    }
+    return op;
+}
+
+// Compress with a greedy LZ77 matcher over a 64KB window (LZ4-style token stream).
+// out must hold lzCompressBound(n) bytes; returns the compressed size.
+size_t lzCompress(const unsigned char* in, size_t n, unsigned char* out) {
+    long table[1 << LZ_HASH_BITS];
+    for (int i = 0; i < (1 << LZ_HASH_BITS); ++i) table[i] = -1;
+
+    size_t ip = 0, anchor = 0, op = 0;
+    while (ip + LZ_MIN_MATCH <= n) {
+        uint32_t sequence;
+        memcpy(&sequence, in + ip, sizeof(sequence));
+        uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+        long candidate = table[hash];
+        table[hash] = (long)ip;
+
+        if (candidate >= 0 && ip - candidate <= 0xFFFF &&
+            memcmp(in + candidate, in + ip, LZ_MIN_MATCH) == 0) {
+            size_t length = LZ_MIN_MATCH;
+            while (ip + length < n && in[candidate + length] == in[ip + length]) length++;
+            op = lzEmitSequence(out, op, in + anchor, ip - anchor, ip - candidate, length);
+            ip += length;
+            anchor = ip;
+        } else {
+            ip++;
+        }
+    }
+    return lzEmitSequence(out, op, in + anchor, n - anchor, 0, 0);
+}
+
+// Decompress exactly outLength bytes; returns false on malformed input
+bool lzDecompress(const unsigned char* in, size_t inLength, unsigned char* out, size_t outLength) {
+    size_t ip = 0, op = 0;
+    while (ip < inLength) {
+        unsigned token = in[ip++];
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            unsigned char extra;
+            do {
+                if (ip >= inLength) return false;
+                extra = in[ip++];
+                literalLength += extra;
+            } while (extra == 255);
+        }
+        if (literalLength > inLength - ip || literalLength > outLength - op) return false;
+        memcpy(out + op, in + ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == inLength) break;
+
+        if (inLength - ip < 2) return false;
+        size_t offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        size_t matchLength = (token & 0x0F);
+        if (matchLength == 15) {
+            unsigned char extra;
+            do {
+                if (ip >= inLength) return false;
+                extra = in[ip++];
+                matchLength += extra;
+            } while (extra == 255);
+        }
+        matchLength += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || matchLength > outLength - op) return false;
+        for (size_t i = 0; i < matchLength; ++i, ++op) {
+            out[op] = out[op - offset];
+        }
+    }
+    return op == outLength;
+}
+
+// Snapshot header; a SnapshotBlock index entry per block follows, then (if tagged)
+// tagCount NUL-terminated category names in tag-bit order
+typedef struct {
+    uint32_t magic;
+    uint32_t flags;
+    uint32_t blockCount;
+    uint32_t tagCount;
+} SnapshotHeader;
+
+// One independently stored subtrie: all words under one root child
+typedef struct {
+    uint32_t letter;
+    uint32_t wordCount;
+    uint32_t rawSize;     // string pool bytes: "word\0", varint frequency, varint tags
+    uint32_t storedSize;  // equal to rawSize unless compressed
+    uint64_t offset;
+} SnapshotBlock;
+
+// Loaded snapshot: blocks are materialized into the trie eagerly or on first access
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    uint32_t flags;
+    uint32_t blockCount;
+    SnapshotBlock* blocks;
+    unsigned char** decoded;  // decompressed pools, filled by the workers
+    bool mapped;              // data is a file mapping rather than a heap copy
+    bool loaded[ALPHABET_SIZE];
+    int blockForLetter[ALPHABET_SIZE];
+    uint32_t tagBits[MAX_TAGS];  // file tag bit -> bit of the same name in tagRegistry
+    int nextBlock;            // work counter shared by decompression workers
+    bool failed;
+} SnapshotStore;
+
+SnapshotStore snapshotStore = { 0 };
+
+// Visitor state used while writing a snapshot
+typedef struct {
+    unsigned char* pool;
+    size_t length;
+    size_t capacity;
+    SnapshotBlock* blocks;
+    int blockCount;
+} SnapshotWriter;
+
+// Visitor: append each terminal to the pool of its root-child block
+int enterSnapshotWord(TrieNode* node, int depth, char letter, void* ctx) {
+    SnapshotWriter* writer = (SnapshotWriter*)ctx;
+    if (depth == 1) {
+        SnapshotBlock* block = &writer->blocks[writer->blockCount++];
+        memset(block, 0, sizeof(*block));
+        block->letter = letter - 'a';
+        block->offset = writer->length; // start within the raw pool for now
+    }
+    const NodePayload* payload = node->isEndOfWord ? nodePayload(node) : NULL;
+    if (payload && payload->originalWord) {
+        size_t needed = strlen(payload->originalWord) + 1 + 10;
+        if (writer->length + needed > writer->capacity) {
+            size_t capacity = writer->capacity ? writer->capacity * 2 : 4096;
+            while (capacity < writer->length + needed) capacity *= 2;
+            unsigned char* pool = (unsigned char*)realloc(writer->pool, capacity);
+            if (!pool) return TRAVERSE_STOP;
+            writer->pool = pool;
+            writer->capacity = capacity;
+        }
+        size_t wordLength = strlen(payload->originalWord) + 1;
+        memcpy(writer->pool + writer->length, payload->originalWord, wordLength);
+        writer->length += wordLength;
+        writer->length += putVarint(writer->pool + writer->length, (uint32_t)payload->frequency);
+        writer->length += putVarint(writer->pool + writer->length, payload->tags);
+        writer->blocks[writer->blockCount - 1].wordCount++;
+    }
+    return TRAVERSE_CONTINUE;
+}
+
+// Write the trie as one block per root child, LZ-compressing each block if requested
+bool saveSnapshot(TrieNode* root, const char* path, bool compress) {
+    SnapshotWriter writer = { 0 };
+    writer.blocks = (SnapshotBlock*)calloc(ALPHABET_SIZE, sizeof(SnapshotBlock));
+    if (!writer.blocks) return false;
+
+    TrieVisitor visitor = { enterSnapshotWord, NULL };
+    if (traverseTrie(root, 0, '\0', &visitor, &writer) == TRAVERSE_STOP) {
+        free(writer.pool);
+        free(writer.blocks);
+        return false;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror("Failed to write snapshot");
+        free(writer.pool);
+        free(writer.blocks);
+        return false;
+    }
+
+    SnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_TAGGED | (compress ? SNAPSHOT_COMPRESSED : 0),
+                              (uint32_t)writer.blockCount, (uint32_t)tagRegistry.count };
+    unsigned char** stored = (unsigned char**)calloc(writer.blockCount + 1, sizeof(unsigned char*));
+    uint64_t offset = sizeof(header) + writer.blockCount * sizeof(SnapshotBlock);
+    for (int i = 0; i < tagRegistry.count; ++i) offset += strlen(tagRegistry.names[i]) + 1;
+    bool ok = stored != NULL;
+
+    for (int b = 0; ok && b < writer.blockCount; ++b) {
+        SnapshotBlock* block = &writer.blocks[b];
+        size_t start = block->offset;
+        size_t end = (b + 1 < writer.blockCount) ? writer.blocks[b + 1].offset : writer.length;
+        block->rawSize = (uint32_t)(end - start);
+        if (compress) {
+            stored[b] = (unsigned char*)malloc(lzCompressBound(block->rawSize));
+            if (!stored[b]) {
+                ok = false;
+                break;
+            }
+            block->storedSize = (uint32_t)lzCompress(writer.pool + start, block->rawSize, stored[b]);
+        } else {
+            stored[b] = writer.pool + start;
+            block->storedSize = block->rawSize;
+        }
+    }
+    for (int b = 0; ok && b < writer.blockCount; ++b) {
+        writer.blocks[b].offset = offset;
+        offset += writer.blocks[b].storedSize;
+    }
+
+    if (ok) {
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(writer.blocks, sizeof(SnapshotBlock), writer.blockCount, file);
+        for (int i = 0; i < tagRegistry.count; ++i) {
+            fwrite(tagRegistry.names[i], 1, strlen(tagRegistry.names[i]) + 1, file);
+        }
+        for (int b = 0; b < writer.blockCount; ++b) {
+            fwrite(stored[b], 1, writer.blocks[b].storedSize, file);
+        }
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    if (compress && stored) {
+        for (int b = 0; b < writer.blockCount; ++b) free(stored[b]);
+    }
+    free(stored);
+    free(writer.pool);
+    free(writer.blocks);
+    return ok;
+}
+
+// Decompress one block into its own pool; uncompressed blocks are used in place
+bool decodeSnapshotBlock(int b) {
+    SnapshotBlock* block = &snapshotStore.blocks[b];
+    if (!(snapshotStore.flags & SNAPSHOT_COMPRESSED)) return true;
+    unsigned char* pool = (unsigned char*)malloc(block->rawSize ? block->rawSize : 1);
+    if (!pool) return false;
+    if (!lzDecompress(snapshotStore.data + block->offset, block->storedSize, pool, block->rawSize)) {
+        free(pool);
+        return false;
+    }
+    snapshotStore.decoded[b] = pool;
+    return true;
+}
+
+#if defined(__linux__)
+// Decompression worker: claims blocks from the shared counter until none remain
+void* snapshotWorker(void* arg) {
+    (void)arg;
+    for (;;) {
+        int b = __atomic_fetch_add(&snapshotStore.nextBlock, 1, __ATOMIC_RELAXED);
+        if (b >= (int)snapshotStore.blockCount) break;
+        if (!decodeSnapshotBlock(b)) __atomic_store_n(&snapshotStore.failed, true, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+#endif
+
+// Insert the words of one block into the trie
+void materializeSnapshotBlock(TrieNode* root, int b) {
+    SnapshotBlock* block = &snapshotStore.blocks[b];
+    if (snapshotStore.loaded[block->letter]) return;
+    snapshotStore.loaded[block->letter] = true;
+
+    if (!snapshotStore.decoded[b] && (snapshotStore.flags & SNAPSHOT_COMPRESSED) &&
+        !decodeSnapshotBlock(b)) {
+        fprintf(stderr, "Corrupt snapshot block for '%c'.\n", 'a' + block->letter);
+        return;
+    }
+    const unsigned char* pool = (snapshotStore.flags & SNAPSHOT_COMPRESSED)
+                                    ? snapshotStore.decoded[b]
+                                    : snapshotStore.data + block->offset;
+    const unsigned char* cursor = pool;
+    const unsigned char* end = pool + block->rawSize;
+    int skipped = 0;
+    bool tagged = snapshotStore.flags & SNAPSHOT_TAGGED;
+    while (cursor < end) {
+        const char* word = (const char*)cursor;
+        const unsigned char* terminator = memchr(cursor, '\0', end - cursor);
+        if (!terminator) break;
+        cursor = terminator + 1;
+        uint32_t frequency, fileTags = 0;
+        if (!varintFits(cursor, end)) break;
+        cursor += getVarint(cursor, &frequency);
+        if (tagged) {
+            if (!varintFits(cursor, end)) break;
+            cursor += getVarint(cursor, &fileTags);
+        }
+        // Only words the loaders themselves would accept reach the trie
+        size_t length = terminator - (const unsigned char*)word;
+        if (length == 0 || length >= MAX_WORD_LENGTH || !isValidWord(word)) {
+            skipped++;
+            continue;
+        }
+        uint32_t tags = 0;
+        for (int i = 0; fileTags; ++i, fileTags >>= 1) {
+            if (fileTags & 1) tags |= snapshotStore.tagBits[i];
+        }
+        char lowerWord[MAX_WORD_LENGTH];
+        foldCase(lowerWord, word, length);
+        lowerWord[length] = '\0';
+        insertNormalizedWord(root, word, lowerWord, (int)frequency, tags);
+    }
+    if (cursor < end || skipped > 0) {
+        fprintf(stderr, "Corrupt snapshot block for '%c'; skipped the damaged entries.\n", 'a' + block->letter);
+    }
+
+    if (snapshotStore.decoded[b]) {
+        free(snapshotStore.decoded[b]);
+        snapshotStore.decoded[b] = NULL;
+    }
+}
+
+// Node of a trie compiled into the binary. Nodes are laid out breadth-first, so the
+// children of a node are contiguous and in letter order.
+typedef struct {
+    uint32_t firstChild;   // index of the first child in the node table
+    uint8_t childCount;
+    int32_t word;          // index into the word tables, -1 if no word ends here
+    int32_t maxFrequency;  // highest frequency in the subtree
+} StaticTrieNode;
+
+// Built with -DSTATIC_DICTIONARY='"file"' naming the output of --emit-c, which
+// defines staticNodes, staticNodeCount, staticLabels, staticWordPool,
+// staticWordOffsets, staticWordFrequencies, staticWordTags and staticTagNames
+#if defined(STATIC_DICTIONARY)
+#include STATIC_DICTIONARY
+#endif
+
+// Read-only trie tables: the compiled-in dictionary, or tables built from the trie.
+// labels[i] is the letter on the edge into node i, so the child labels of a node
+// form one contiguous byte string; the array is padded by LABEL_PADDING bytes so a
+// whole vector can be loaded from any node's first child. Queries on the compiled-in
+// dictionary are answered straight from the tables; a root letter is only copied
+// into the trie when a feature needs it there.
+typedef struct {
+    const StaticTrieNode* nodes;
+    uint32_t nodeCount;
+    const unsigned char* labels;
+    const char* pool;
+    const uint32_t* offsets;
+    const int32_t* frequencies;
+    const uint32_t* tags;
+    bool active;
+    bool loaded[ALPHABET_SIZE];
+} StaticDictionary;
+
+StaticDictionary staticDictionary = { 0 };
+
+// Use the compiled-in dictionary if this binary has one
+bool openStaticDictionary() {
+#if defined(STATIC_DICTIONARY)
+    staticDictionary.nodes = staticNodes;
+    staticDictionary.nodeCount = staticNodeCount;
+    staticDictionary.labels = staticLabels;
+    staticDictionary.pool = staticWordPool;
+    staticDictionary.offsets = staticWordOffsets;
+    staticDictionary.frequencies = staticWordFrequencies;
+    staticDictionary.tags = staticWordTags;
+    staticDictionary.active = true;
+    // Register the categories in their original order so the tag bits line up
+    for (int i = 0; staticTagNames[i]; ++i) lookupTag(staticTagNames[i], strlen(staticTagNames[i]), true);
+#endif
+    return staticDictionary.active;
+}
+
+// Number of words in the compiled-in dictionary
+uint32_t staticWordCount() {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < staticDictionary.nodeCount; ++i) {
+        if (staticDictionary.nodes[i].word >= 0) count++;
+    }
+    return count;
+}
+
+// Child label search: position of label among count labels, or -1. Nodes with up to
+// 4 children compare one 32-bit word at once; larger nodes use the widest vector
+// compare the CPU supports, chosen at startup by selectSimdKernels.
+int findLabelScalar(const unsigned char* labels, int count, unsigned char label) {
+    for (int i = 0; i < count; ++i) {
+        if (labels[i] == label) return i;
+    }
+    return -1;
+}
+
+// Up to 4 labels: XOR with the broadcast label and find the lowest zero byte
+int findLabel4(const unsigned char* labels, int count, unsigned char label) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint32_t word;
+    memcpy(&word, labels, 4);
+    uint32_t x = word ^ (0x01010101u * label);
+    uint32_t zero = (x - 0x01010101u) & ~x & 0x80808080u;
+    if (count < 4) zero &= (1u << (count * 8)) - 1;
+    return zero ? __builtin_ctz(zero) >> 3 : -1;
+#else
+    return findLabelScalar(labels, count, label);
+#endif
+}
+
+#if defined(__SSE2__)
+// Up to 32 labels with one or two 16-byte compares
+int findLabelSse2(const unsigned char* labels, int count, unsigned char label) {
+    __m128i needle = _mm_set1_epi8((char)label);
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)labels), needle));
+    if (count > 16) {
+        mask |= (uint32_t)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(labels + 16)), needle)) << 16;
+    }
+    if (count < 32) mask &= (1u << count) - 1;
+    return mask ? __builtin_ctz(mask) : -1;
+}
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+// Up to 32 labels with a single 32-byte compare
+__attribute__((target("avx2")))
+int findLabelAvx2(const unsigned char* labels, int count, unsigned char label) {
+    __m256i hits = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)labels),
+                                     _mm256_set1_epi8((char)label));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(hits);
+    if (count < 32) mask &= (1u << count) - 1;
+    return mask ? __builtin_ctz(mask) : -1;
+}
+#endif
+
+typedef int (*LabelFinder)(const unsigned char* labels, int count, unsigned char label);
+
+// A pairing of small- and wide-node searches, for the benchmark
+typedef struct {
+    const char* name;
+    LabelFinder small;
+    LabelFinder wide;
+} LabelSearch;
+
+LabelFinder findLabelSmall = findLabel4;
+LabelFinder findLabelWide = findLabelScalar;
+
+// Pick the widest label search and text kernels this CPU supports
+void selectSimdKernels() {
+#if defined(__SSE2__)
+    findLabelWide = findLabelSse2;
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        findLabelWide = findLabelAvx2;
+        foldCaseBlocks = foldCaseBlocksAvx2;
+        letterBlocks = letterBlocksAvx2;
+        screenSignatures = screenSignaturesAvx2;
+    }
+#endif
+}
+
+// Child of a static node for a letter, or -1
+int64_t staticChild(const StaticDictionary* dict, uint32_t node, char letter) {
+    const StaticTrieNode* parent = &dict->nodes[node];
+    if (parent->childCount == 0) return -1;
+    const unsigned char* labels = dict->labels + parent->firstChild;
+    int i = parent->childCount <= 4 ? findLabelSmall(labels, parent->childCount, (unsigned char)letter)
+                                    : findLabelWide(labels, parent->childCount, (unsigned char)letter);
+    return i < 0 ? -1 : (int64_t)parent->firstChild + i;
+}
+
+// Static node reached by a lowercase key, or -1
+int64_t staticFindNode(const StaticDictionary* dict, const char* lowerKey) {
+    if (dict->nodeCount == 0) return -1;
+    int64_t node = 0;
+    for (int i = 0; lowerKey[i] && node >= 0; ++i) node = staticChild(dict, (uint32_t)node, lowerKey[i]);
+    return node;
+}
+
+// Collect the top completions below a static node, skipping subtrees that cannot
+// displace anything already in a full list
+void collectStaticSuggestions(const StaticDictionary* dict, uint32_t start, SuggestionList* list) {
+    uint32_t stack[MAX_WORD_LENGTH * ALPHABET_SIZE + 1];
+    int top = 0;
+    stack[top++] = start;
+    while (top > 0) {
+        const StaticTrieNode* node = &dict->nodes[stack[--top]];
+        if (node->maxFrequency <= suggestionFloor(list)) continue;
+        if (node->word >= 0) {
+            addSuggestion(list, dict->pool + dict->offsets[node->word], 0, dict->frequencies[node->word]);
+        }
+        for (uint32_t i = node->childCount; i > 0; --i) stack[top++] = node->firstChild + i - 1;
+    }
+}
+
+// Answer a prefix search from the compiled-in dictionary while its root letter has
+// not been copied into the trie; returns false if the trie has to answer instead
+bool searchStaticPrefix(const char* prefix, const char* lowerPrefix) {
+    if (!staticDictionary.active || !*lowerPrefix) return false;
+    if (staticDictionary.loaded[lowerPrefix[0] - 'a']) return false;
+    int64_t node = staticFindNode(&staticDictionary, lowerPrefix);
+    if (node < 0) return false;
+
+    SuggestionList suggestions;
+    initSuggestionList(&suggestions, true);
+    collectStaticSuggestions(&staticDictionary, (uint32_t)node, &suggestions);
+    printPrefixSuggestions(prefix, &suggestions);
+    return true;
+}
+
+// Copy every word under one root letter of the compiled-in dictionary into the trie
+void materializeStaticLetter(TrieNode* root, int letter) {
+    if (!staticDictionary.active || staticDictionary.loaded[letter]) return;
+    staticDictionary.loaded[letter] = true;
+    int64_t start = staticChild(&staticDictionary, 0, 'a' + letter);
+    if (start < 0) return;
+
+    uint32_t stack[MAX_WORD_LENGTH * ALPHABET_SIZE + 1];
+    int top = 0;
+    stack[top++] = (uint32_t)start;
+    while (top > 0) {
+        const StaticTrieNode* node = &staticDictionary.nodes[stack[--top]];
+        if (node->word >= 0) {
+            const char* word = staticDictionary.pool + staticDictionary.offsets[node->word];
+            char* lowerWord = strtolower(word);
+            if (lowerWord) {
+                insertNormalizedWord(root, word, lowerWord, staticDictionary.frequencies[node->word],
+                                     staticDictionary.tags[node->word]);
+                free(lowerWord);
+            }
+        }
+        for (uint32_t i = 0; i < node->childCount; ++i) stack[top++] = node->firstChild + i;
+    }
+}
+
+// Lay the trie out as static tables: nodes breadth-first, words in node order, and
+// offsets with one extra entry for the end of the pool
+bool buildStaticTables(TrieNode* root, StaticDictionary* dict) {
+    size_t capacity = nodeArena.nodesInUse + 1;
+    TrieNode** order = (TrieNode**)malloc(capacity * sizeof(TrieNode*));
+    StaticTrieNode* nodes = (StaticTrieNode*)malloc(capacity * sizeof(StaticTrieNode));
+    unsigned char* labels = (unsigned char*)calloc(capacity + LABEL_PADDING, 1);
+    if (!order || !nodes || !labels) {
+        free(order);
+        free(nodes);
+        free(labels);
+        return false;
+    }
+
+    size_t count = 0, words = 0, poolBytes = 0;
+    order[count++] = root;
+    for (size_t i = 0; i < count; ++i) {
+        nodes[i].firstChild = (uint32_t)count;
+        nodes[i].childCount = 0;
+        for (int c = 0; c < ALPHABET_SIZE; ++c) {
+            TrieNode* child = childNode(order[i], c);
+            if (!child) continue;
+            labels[count] = 'a' + c;
+            order[count++] = child;
+            nodes[i].childCount++;
+        }
+        if (!nodes[i].childCount) nodes[i].firstChild = 0;
+        bool isWord = order[i]->isEndOfWord && nodePayload(order[i])->originalWord;
+        nodes[i].word = isWord ? (int32_t)words++ : -1;
+        nodes[i].maxFrequency = nodeSummary(order[i])->maxFrequency;
+        if (isWord) poolBytes += strlen(nodePayload(order[i])->originalWord) + 1;
+    }
+
+    char* pool = (char*)malloc(poolBytes + 1);
+    uint32_t* offsets = (uint32_t*)malloc((words + 1) * sizeof(uint32_t));
+    int32_t* frequencies = (int32_t*)malloc((words + 1) * sizeof(int32_t));
+    uint32_t* tags = (uint32_t*)malloc((words + 1) * sizeof(uint32_t));
+    if (!pool || !offsets || !frequencies || !tags) {
+        free(order);
+        free(nodes);
+        free(labels);
+        free(pool);
+        free(offsets);
+        free(frequencies);
+        free(tags);
+        return false;
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (nodes[i].word < 0) continue;
+        const NodePayload* payload = nodePayload(order[i]);
+        size_t length = strlen(payload->originalWord) + 1;
+        memcpy(pool + offset, payload->originalWord, length);
+        offsets[nodes[i].word] = (uint32_t)offset;
+        frequencies[nodes[i].word] = payload->frequency;
+        tags[nodes[i].word] = payload->tags;
+        offset += length;
+    }
+    offsets[words] = (uint32_t)offset;
+    frequencies[words] = 0;
+    tags[words] = 0;
+    free(order);
+
+    memset(dict, 0, sizeof(*dict));
+    dict->nodes = nodes;
+    dict->nodeCount = (uint32_t)count;
+    dict->labels = labels;
+    dict->pool = pool;
+    dict->offsets = offsets;
+    dict->frequencies = frequencies;
+    dict->tags = tags;
+    return true;
+}
+
+// Release tables made by buildStaticTables
+void freeStaticTables(StaticDictionary* dict) {
+    free((void*)dict->nodes);
+    free((void*)dict->labels);
+    free((void*)dict->pool);
+    free((void*)dict->offsets);
+    free((void*)dict->frequencies);
+    free((void*)dict->tags);
+    memset(dict, 0, sizeof(*dict));
+}
+
+// Write a C string literal body for a word
+void emitCString(FILE* file, const char* word) {
+    for (; *word; ++word) {
+        if (*word == '"' || *word == '\\') fputc('\\', file);
+        fputc(*word, file);
+    }
+}
+
+// Emit the trie as C source: the static tables plus the category names, all
+// static const
+bool emitStaticDictionary(TrieNode* root, const char* path) {
+    StaticDictionary dict;
+    if (!buildStaticTables(root, &dict)) return false;
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror("Failed to open output file");
+        freeStaticTables(&dict);
+        return false;
+    }
+    uint32_t words = 0;
+    for (uint32_t i = 0; i < dict.nodeCount; ++i) words += dict.nodes[i].word >= 0;
+
+    fprintf(file, "// Generated by trie-suggester --emit-c; do not edit.\n");
+    fprintf(file, "static const uint32_t staticNodeCount = %u;\n", dict.nodeCount);
+    fprintf(file, "static const StaticTrieNode staticNodes[%u] = {\n", dict.nodeCount);
+    for (uint32_t i = 0; i < dict.nodeCount; ++i) {
+        const StaticTrieNode* node = &dict.nodes[i];
+        fprintf(file, "    { %u, %u, %d, %d },\n", node->firstChild, node->childCount, node->word,
+                node->maxFrequency);
+    }
+    fprintf(file, "};\n");
+
+    // Labels as one literal, 64 per line; the declared size zero-fills the padding
+    fprintf(file, "static const unsigned char staticLabels[%u] =\n    \"\\0", dict.nodeCount + LABEL_PADDING);
+    for (uint32_t i = 1; i < dict.nodeCount; ++i) {
+        if (i % 64 == 0) fprintf(file, "\"\n    \"");
+        fputc(dict.labels[i], file);
+    }
+    fprintf(file, "\";\n");
+
+    fprintf(file, "static const char staticWordPool[] =\n    \"\"");
+    for (uint32_t w = 0; w < words; ++w) {
+        fprintf(file, "\n    \"");
+        emitCString(file, dict.pool + dict.offsets[w]);
+        fprintf(file, "\\0\"");
+    }
+    fprintf(file, ";\n");
+    fprintf(file, "static const uint32_t staticWordOffsets[%u] = {\n", words + 1);
+    for (uint32_t w = 0; w <= words; ++w) fprintf(file, "    %u,\n", dict.offsets[w]);
+    fprintf(file, "};\n");
+    fprintf(file, "static const int32_t staticWordFrequencies[%u] = {\n", words + 1);
+    for (uint32_t w = 0; w <= words; ++w) fprintf(file, "    %d,\n", dict.frequencies[w]);
+    fprintf(file, "};\n");
+    fprintf(file, "static const uint32_t staticWordTags[%u] = {\n", words + 1);
+    for (uint32_t w = 0; w <= words; ++w) fprintf(file, "    %uu,\n", dict.tags[w]);
+    fprintf(file, "};\n");
+    fprintf(file, "static const char* const staticTagNames[%d] = {\n", tagRegistry.count + 1);
+    for (int i = 0; i < tagRegistry.count; ++i) {
+        fprintf(file, "    \"");
+        emitCString(file, tagRegistry.names[i]);
+        fprintf(file, "\",\n");
+    }
+    fprintf(file, "    NULL\n};\n");
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    freeStaticTables(&dict);
+    return ok;
+}
+
+// Time exact lookups of random dictionary words: the trie's direct children[]
+// indexing against the static tables' child label search in each variant
+void benchmarkChildLookup(TrieNode* root, int lookups) {
+    WordTable* table = getWordTable(root);
+    StaticDictionary dict;
+    if (table->count == 0 || !buildStaticTables(root, &dict)) return;
+    const char** keys = (const char**)malloc(lookups * sizeof(char*));
+    if (!keys) {
+        freeStaticTables(&dict);
+        return;
+    }
+    uint64_t state = 88172645463325252ull;
+    for (int i = 0; i < lookups; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        keys[i] = table->lowerWords[state % (uint64_t)table->count];
+    }
+
+    int small = 0, medium = 0, large = 0;
+    for (uint32_t i = 0; i < dict.nodeCount; ++i) {
+        int children = dict.nodes[i].childCount;
+        if (children == 0) continue;
+        if (children <= 4) small++;
+        else if (children <= 16) medium++;
+        else large++;
+    }
+    printf("Child lookup benchmark: %d lookups; inner nodes with 1-4 children: %d, 5-16: %d, 17+: %d\n",
+           lookups, small, medium, large);
+
+    double start = nowSeconds();
+    int found = 0;
+    for (int i = 0; i < lookups; ++i) found += findNode(root, keys[i]) != NULL;
+    double elapsed = nowSeconds() - start;
+    printf("  %-34s %7.1f ns/lookup (%d found)\n", "direct children[] indexing",
+           elapsed * 1e9 / lookups, found);
+
+    LabelSearch variants[3];
+    int variantCount = 0;
+    variants[variantCount++] = (LabelSearch){ "label scan (scalar)", findLabelScalar, findLabelScalar };
+#if defined(__SSE2__)
+    variants[variantCount++] = (LabelSearch){ "label search (SWAR + SSE2)", findLabel4, findLabelSse2 };
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    if (__builtin_cpu_supports("avx2")) {
+        variants[variantCount++] = (LabelSearch){ "label search (SWAR + AVX2)", findLabel4, findLabelAvx2 };
+    }
+#endif
+    LabelFinder savedSmall = findLabelSmall;
+    LabelFinder savedWide = findLabelWide;
+    for (int v = 0; v < variantCount; ++v) {
+        findLabelSmall = variants[v].small;
+        findLabelWide = variants[v].wide;
+        start = nowSeconds();
+        found = 0;
+        for (int i = 0; i < lookups; ++i) {
+            int64_t node = staticFindNode(&dict, keys[i]);
+            found += node >= 0 && dict.nodes[node].word >= 0;
+        }
+        elapsed = nowSeconds() - start;
+        printf("  %-34s %7.1f ns/lookup (%d found)\n", variants[v].name, elapsed * 1e9 / lookups, found);
+    }
+    findLabelSmall = savedSmall;
+    findLabelWide = savedWide;
+
+    free(keys);
+    freeStaticTables(&dict);
+}
+
+// Make sure the subtrie a lowercase prefix starts in has been materialized
+void ensureSnapshotPrefix(TrieNode* root, const char* lowerPrefix) {
+    if (!*lowerPrefix) return;
+    materializeStaticLetter(root, lowerPrefix[0] - 'a');
+    if (!snapshotStore.data) return;
+    int b = snapshotStore.blockForLetter[lowerPrefix[0] - 'a'];
+    if (b >= 0) materializeSnapshotBlock(root, b);
+}
+
+// Materialize every remaining block
+void ensureSnapshotAll(TrieNode* root) {
+    for (int letter = 0; letter < ALPHABET_SIZE; ++letter) materializeStaticLetter(root, letter);
+    if (!snapshotStore.data) return;
+    for (uint32_t b = 0; b < snapshotStore.blockCount; ++b) {
+        materializeSnapshotBlock(root, b);
+    }
+}
+
+// Read a whole file through the AsyncReader into one heap buffer; NULL with errno set
+// if it cannot be opened or read in full
+unsigned char* readWholeFile(const char* path, size_t* size) {
+    AsyncReader reader;
+    if (!asyncReaderOpen(&reader, path)) return NULL;
+    unsigned char* data = (unsigned char*)malloc(reader.fileSize ? (size_t)reader.fileSize : 1);
+    size_t filled = 0;
+    const char* chunk;
+    size_t length;
+    while (data && asyncReaderNext(&reader, &chunk, &length)) {
+        if (length > (size_t)reader.fileSize - filled) length = (size_t)reader.fileSize - filled;
+        memcpy(data + filled, chunk, length);
+        filled += length;
+    }
+    bool complete = data && !reader.failed && filled == (size_t)reader.fileSize;
+    asyncReaderClose(&reader);
+    if (!complete) {
+        free(data);
+        errno = data ? EIO : ENOMEM;
+        return NULL;
+    }
+    *size = filled;
+    return data;
+}
+
+// Release the snapshot data and any decoded blocks
+void closeSnapshot() {
+    if (!snapshotStore.data) return;
+    if (snapshotStore.decoded) {
+        for (int b = 0; b < ALPHABET_SIZE; ++b) free(snapshotStore.decoded[b]);
+        free(snapshotStore.decoded);
+    }
+#if defined(__linux__)
+    if (snapshotStore.mapped) munmap(snapshotStore.data, snapshotStore.size);
+    else free(snapshotStore.data);
+#else
+    free(snapshotStore.data);
+#endif
+    memset(&snapshotStore, 0, sizeof(snapshotStore));
+}
+
+// Load a snapshot and validate its block index. Unless lazy, the file is streamed in
+// through the AsyncReader and all blocks are decompressed in parallel and inserted.
+// Lazily, the file is mapped instead: a block is decoded on its first query, possibly
+// long after startup, and blocks that are never queried are never read from disk.
+bool loadSnapshot(TrieNode* root, const char* path, bool lazy) {
+    size_t size = 0;
+#if defined(__linux__)
+    if (lazy) {
+        int fd = open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            perror("Failed to open snapshot");
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        size = (size_t)st.st_size;
+        void* data = size >= sizeof(SnapshotHeader) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+        close(fd);
+        if (data == MAP_FAILED) {
+            perror("Failed to map snapshot");
+            return false;
+        }
+        snapshotStore.data = (unsigned char*)data;
+        snapshotStore.mapped = data != NULL;
+    }
+#endif
+    if (!snapshotStore.mapped) {
+        snapshotStore.data = readWholeFile(path, &size);
+        if (!snapshotStore.data) {
+            perror("Failed to read snapshot");
+            return false;
+        }
+    }
+    snapshotStore.size = size;
+    if (size < sizeof(SnapshotHeader)) {
+        fprintf(stderr, "Invalid snapshot: %s\n", path);
+        closeSnapshot();
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, snapshotStore.data, sizeof(header));
+    bool valid = header.magic == SNAPSHOT_MAGIC && header.blockCount <= ALPHABET_SIZE &&
+                 sizeof(header) + header.blockCount * sizeof(SnapshotBlock) <= (size_t)size;
+    snapshotStore.flags = header.flags;
+    snapshotStore.blockCount = valid ? header.blockCount : 0;
+    snapshotStore.blocks = (SnapshotBlock*)(snapshotStore.data + sizeof(header));
+    snapshotStore.decoded = (unsigned char**)calloc(ALPHABET_SIZE, sizeof(unsigned char*));
+    for (int i = 0; i < ALPHABET_SIZE; ++i) snapshotStore.blockForLetter[i] = -1;
+
+    for (uint32_t b = 0; valid && b < header.blockCount; ++b) {
+        SnapshotBlock* block = &snapshotStore.blocks[b];
+        // An LZ sequence expands to at most about 255 times its size, which bounds
+        // the decode buffer by the file size
+        valid = block->letter < ALPHABET_SIZE && block->offset + block->storedSize <= (uint64_t)size &&
+                ((header.flags & SNAPSHOT_COMPRESSED) ? block->rawSize / 255 <= block->storedSize
+                                                      : block->storedSize == block->rawSize);
+        if (valid) snapshotStore.blockForLetter[block->letter] = (int)b;
+    }
+    // Map the file's tag bits onto the registry, which may already hold other names;
+    // like parseTagList, a name that no longer fits in the registry is dropped
+    size_t namesOffset = sizeof(header) + header.blockCount * sizeof(SnapshotBlock);
+    uint32_t tagCount = (header.flags & SNAPSHOT_TAGGED) ? header.tagCount : 0;
+    valid = valid && tagCount <= MAX_TAGS;
+    for (uint32_t i = 0; valid && i < tagCount; ++i) {
+        const char* name = (const char*)snapshotStore.data + namesOffset;
+        const char* terminator = memchr(name, '\0', size - namesOffset);
+        valid = terminator && terminator > name;
+        if (valid) {
+            int tag = lookupTag(name, terminator - name, true);
+            snapshotStore.tagBits[i] = tag >= 0 ? 1u << tag : 0;
+            namesOffset += terminator - name + 1;
+        }
+    }
+    if (!valid || !snapshotStore.decoded) {
+        fprintf(stderr, "Invalid snapshot: %s\n", path);
+        closeSnapshot();
+        return false;
+    }
+    if (lazy) return true;
+
+    if (header.flags & SNAPSHOT_COMPRESSED) {
+#if defined(__linux__)
+        pthread_t workers[SNAPSHOT_WORKERS];
+        int started = 0;
+        snapshotStore.nextBlock = 0;
+        for (int i = 0; i < SNAPSHOT_WORKERS; ++i) {
+            if (pthread_create(&workers[i], NULL, snapshotWorker, NULL) == 0) started++;
+        }
+        if (started == 0) snapshotWorker(NULL);
+        for (int i = 0; i < started; ++i) pthread_join(workers[i], NULL);
+#else
+        for (uint32_t b = 0; b < header.blockCount; ++b) {
+            if (!decodeSnapshotBlock(b)) snapshotStore.failed = true;
+        }
+#endif
+        if (snapshotStore.failed) {
+            fprintf(stderr, "Corrupt snapshot: %s\n", path);
+            closeSnapshot();
+            return false;
+        }
+    }
+    ensureSnapshotAll(root);
+    return true;
+}
+
+// Buffered line input for the interactive prompts
+typedef struct {
+    FILE* file;
+    char* buffer;     // LINE_READER_SIZE bytes plus room for a terminator
+    size_t start;     // first unread byte
+    size_t end;       // end of the buffered bytes
+    bool eof;
+    bool skipping;    // dropping the rest of a line longer than the buffer
+} LineReader;
+
+LineReader inputReader = { NULL, NULL, 0, 0, false, false };
+
+void initLineReader(LineReader* reader, FILE* file) {
+    reader->file = file;
+    reader->buffer = (char*)malloc(LINE_READER_SIZE + 1);
+    if (!reader->buffer) {
+        perror("Failed to allocate input buffer");
+        exit(EXIT_FAILURE);
+    }
+    reader->start = reader->end = 0;
+    reader->eof = reader->skipping = false;
+}
+
+void freeLineReader(LineReader* reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+}
+
+// Move the unread bytes to the front and read more after them; false at end of
+// input or when the buffer is already full
+bool refillLineReader(LineReader* reader) {
+    if (reader->eof) return false;
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->end == LINE_READER_SIZE) return false;
+
+    fflush(stdout); // the prompt must be visible before blocking on input
+#if defined(__linux__)
+    ssize_t got;
+    do {
+        got = read(fileno(reader->file), reader->buffer + reader->end, LINE_READER_SIZE - reader->end);
+    } while (got < 0 && errno == EINTR);
+#else
+    // fgets returns at a newline, so an interactive read does not wait for a full buffer
+    long got = -1;
+    if (fgets(reader->buffer + reader->end, (int)(LINE_READER_SIZE - reader->end + 1), reader->file)) {
+        got = (long)strlen(reader->buffer + reader->end);
+    }
+#endif
+    if (got <= 0) {
+        reader->eof = true;
+        return false;
+    }
+    reader->end += (size_t)got;
+    return true;
+}
+
+// Next line without its line ending, NUL-terminated in the reader's buffer and valid
+// until the next read; NULL at end of input. A line longer than the buffer is cut
+// to the buffer's size and the rest of it is dropped.
+char* readLine(LineReader* reader, size_t* length) {
+    while (reader->skipping) {
+        char* newline = memchr(reader->buffer + reader->start, '\n', reader->end - reader->start);
+        if (newline) {
+            reader->start = newline - reader->buffer + 1;
+            reader->skipping = false;
+        } else {
+            reader->start = reader->end;
+            if (!refillLineReader(reader)) return NULL;
+        }
+    }
+
+    size_t scanned = 0; // bytes past start already searched for a newline
+    char* line;
+    for (;;) {
+        line = reader->buffer + reader->start;
+        size_t available = reader->end - reader->start;
+        char* newline = memchr(line + scanned, '\n', available - scanned);
+        if (newline) {
+            *length = newline - line;
+            reader->start += *length + 1;
+            break;
+        }
+        scanned = available;
+        if (!refillLineReader(reader)) {
+            line = reader->buffer + reader->start;
+            *length = reader->end - reader->start;
+            if (*length == 0) return NULL;
+            reader->skipping = !reader->eof;
+            reader->start = reader->end;
+            break;
+        }
+    }
+    if (*length > 0 && line[*length - 1] == '\r') (*length)--;
+    line[*length] = '\0';
+    return line;
+}
+
+// Next non-blank line with surrounding whitespace trimmed; NULL at end of input
+char* readField(LineReader* reader, size_t* length) {
+    char* line;
+    while ((line = readLine(reader, length))) {
+        char* end = line + *length;
+        while (line < end && isspace((unsigned char)*line)) line++;
+        while (end > line && isspace((unsigned char)end[-1])) end--;
+        if (end > line) {
+            *end = '\0';
+            *length = end - line;
+            return line;
+        }
+    }
+    return NULL;
+}
+
+// Read a word-sized field into out (MAX_WORD_LENGTH bytes); false at end of input.
+// A field too long to be a word comes back empty.
+bool readWordField(LineReader* reader, char* out) {
+    size_t length;
+    char* field = readField(reader, &length);
+    if (!field) return false;
+    if (length >= MAX_WORD_LENGTH) length = 0;
+    memcpy(out, field, length);
+    out[length] = '\0';
+    return true;
+}
+
+// Read an integer field; false at end of input, *valid tells whether it parsed
+bool readIntegerField(LineReader* reader, int* value, bool* valid) {
+    size_t length;
+    char* field = readField(reader, &length);
+    if (!field) return false;
+    *valid = parseInteger(field, length, value);
+    return true;
+}
+
+// Interactive menu
+void showMenu() {
+    printf("\nMenu:\n");
+    printf("1. Search by prefix\n");
+    printf("2. Show all words\n");
+    printf("3. Search by prefix with filters\n");
+    printf("4. Browse completions page by page\n");
+    printf("5. Spell check a word\n");
+    printf("6. Exit\n");
+    printf("Choose an option: ");
+}
+
+int main(int argc, char* argv[]) {
+    const char* dictionaryPath = NULL;
+    const char* queryLogPath = NULL;
+    const char* snapshotPath = NULL;
+    const char* saveSnapshotPath = NULL;
+    const char* emitCPath = NULL;
+    int benchmarkLookups = 0;
+    int number;
+    bool lazySnapshot = false;
+    bool compressSnapshot = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--no-huge-pages") == 0) {
+            nodeArena.useHugePages = false;
+        } else if (strcmp(argv[i], "--memory-budget") == 0 && i + 1 < argc) {
+            memoryBudget.limit = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dictionary") == 0 && i + 1 < argc) {
+            dictionaryPath = argv[++i];
+        } else if (strcmp(argv[i], "--query-log") == 0 && i + 1 < argc) {
+            queryLogPath = argv[++i];
+        } else if (strcmp(argv[i], "--promote-threshold") == 0 && i + 1 < argc &&
+                   parseOption(argv[i + 1], 1, INT_MAX, &number)) {
+            querySketch.threshold = (uint32_t)number;
+            i++;
+        } else if (strcmp(argv[i], "--sketch-width") == 0 && i + 1 < argc &&
+                   parseOption(argv[i + 1], 1, INT_MAX, &number)) {
+            querySketch.width = (uint32_t)number;
+            i++;
+        } else if (strcmp(argv[i], "--ingest-stats") == 0) {
+            ingestStats = true;
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if (strcmp(argv[i], "--lazy-snapshot") == 0) {
+            lazySnapshot = true;
+        } else if (strcmp(argv[i], "--save-snapshot") == 0 && i + 1 < argc) {
+            saveSnapshotPath = argv[++i];
+        } else if (strcmp(argv[i], "--compress-snapshot") == 0) {
+            compressSnapshot = true;
+        } else if (strcmp(argv[i], "--tail-file") == 0 && i + 1 < argc) {
+            tailTier.path = argv[++i];
+        } else if (strcmp(argv[i], "--hot-min-frequency") == 0 && i + 1 < argc &&
+                   parseOption(argv[i + 1], INT_MIN, INT_MAX, &tailTier.hotMinFrequency)) {
+            tailTier.demote = true;
+            i++;
+        } else if (strcmp(argv[i], "--burst-trie") == 0) {
+            useBurstTrie = true;
+        } else if (strcmp(argv[i], "--benchmark-lookups") == 0 && i + 1 < argc &&
+                   parseOption(argv[i + 1], 1, INT_MAX, &benchmarkLookups)) {
+            i++;
+        } else if (strcmp(argv[i], "--emit-c") == 0 && i + 1 < argc) {
+            emitCPath = argv[++i];
+        } else if (strcmp(argv[i], "--spell-distance") == 0 && i + 1 < argc &&
+                   parseOption(argv[i + 1], 1, MAX_SPELL_DISTANCE, &spellDistance)) {
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--dictionary PATH [--ingest-stats]] [--no-huge-pages]\n"
+                            "       [--memory-budget BYTES]\n"
+                            "       [--query-log PATH [--promote-threshold N] [--sketch-width W]]\n"
+                            "       [--tail-file PATH [--hot-min-frequency F]]\n"
+                            "       [--snapshot PATH [--lazy-snapshot]]\n"
+                            "       [--save-snapshot PATH [--compress-snapshot]]\n"
+                            "       [--emit-c PATH] [--spell-distance K] [--burst-trie]\n"
+                            "       [--benchmark-lookups N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (useBurstTrie && (snapshotPath || saveSnapshotPath || queryLogPath || tailTier.path || emitCPath)) {
+        fprintf(stderr, "--burst-trie only supports --dictionary and interactive entry.\n");
+        return EXIT_FAILURE;
+    }
+
+    selectSimdKernels();
+    initLineReader(&inputReader, stdin);
+    TrieNode* root = createTrieNode();
+    if (!root) {
+        perror("Failed to create Trie node");
+        return EXIT_FAILURE;
+    }
+
+    printf("Trie-Based Word Suggestion System\n");
+    if (snapshotPath) {
+        if (!loadSnapshot(root, snapshotPath, lazySnapshot)) {
+            freeTrie(root);
+            destroyNodeArena();
+            freeLineReader(&inputReader);
+            return EXIT_FAILURE;
+        }
+        printf("Opened snapshot %s (%u block(s)%s%s).\n", snapshotPath, snapshotStore.blockCount,
+               (snapshotStore.flags & SNAPSHOT_COMPRESSED) ? ", compressed" : "",
+               lazySnapshot ? ", loaded on demand" : "");
+    }
+    if (dictionaryPath) {
+        int loaded, rejected;
+        if (!loadDictionaryFile(root, dictionaryPath, &loaded, &rejected)) {
+            freeTrie(root);
+            destroyNodeArena();
+            freeLineReader(&inputReader);
+            return EXIT_FAILURE;
+        }
+        printf("Loaded %d word(s) from %s", loaded, dictionaryPath);
+        if (rejected > 0) printf(" (%d invalid line(s) skipped)", rejected);
+        printf(".\n");
+    } else if (!snapshotPath && !queryLogPath && !useBurstTrie && openStaticDictionary()) {
+        printf("Using the built-in dictionary (%u word(s)).\n", staticWordCount());
+    } else if (!snapshotPath && !queryLogPath) {
+        int n = 0;
+        bool valid = false;
+        printf("How many words do you want to enter? (1-%d): ", MAX_WORDS);
+
+        while (readIntegerField(&inputReader, &n, &valid) && (!valid || n <= 0 || n > MAX_WORDS)) {
+            printf("Invalid input. Enter a number between 1 and %d: ", MAX_WORDS);
+        }
+        if (!valid) n = 0; // input ended before a count was given
+
+        printf("Enter words (one per line) with optional frequency and categories (word:freq:tag,tag):\n");
+        for (int i = 0; i < n; ) {
+            int frequency = 0;
+            uint32_t tags = 0;
+            size_t length;
+
+            char* input = readField(&inputReader, &length);
+            if (!input) break;
+
+            // Split off the frequency and category suffixes (word:frequency:tags) in place
+            char* word = parseDictionaryLine(input, length, &frequency, &tags);
+            if (!word) {
+                printf("Invalid word. Try again.\n");
+                continue;
+            }
+
+            addWordEntry(root, word, NULL, frequency, tags);
+            i++;
+        }
+    }
+
+    if (queryLogPath) {
+        int observed, rejected;
+        if (loadQueryLog(root, queryLogPath, &observed, &rejected)) {
+            printf("Observed %d query line(s) from %s; promoted %d new word(s) at threshold %u.\n",
+                   observed, queryLogPath, querySketch.promoted, querySketch.threshold);
+        }
+    }
+
+    if (saveSnapshotPath) {
+        ensureSnapshotAll(root);
+        if (saveSnapshot(root, saveSnapshotPath, compressSnapshot)) {
+            printf("Saved snapshot to %s.\n", saveSnapshotPath);
+        } else {
+            fprintf(stderr, "Failed to save snapshot to %s.\n", saveSnapshotPath);
+        }
+    }
+
+    if (emitCPath) {
+        ensureSnapshotAll(root);
+        if (emitStaticDictionary(root, emitCPath)) {
+            printf("Wrote the dictionary as C source to %s.\n", emitCPath);
+        } else {
+            fprintf(stderr, "Failed to write %s.\n", emitCPath);
+        }
+    }
+
+    if (benchmarkLookups > 0) {
+        ensureSnapshotAll(root);
+        benchmarkChildLookup(root, benchmarkLookups);
+    }
+
+    // Build the tail from the demoted words, or reuse an existing tail file
+    if (tailTier.path) {
+        int demoted = tailTier.pendingCount;
+        if (tailTier.demote && !writeTailFile(tailTier.path)) {
+            fprintf(stderr, "Continuing without the on-disk tail.\n");
+        } else if (!openTailFile(tailTier.path)) {
+            fprintf(stderr, "Could not open tail file %s; continuing without it.\n", tailTier.path);
+            closeTailFile();
+        } else if (tailTier.demote) {
+            printf("Moved %d low-frequency word(s) to the on-disk tail.\n", demoted);
+        }
+    }
+
+    if (memoryBudget.evictions > 0) {
+        printf("Evicted %d low-frequency word(s) to stay within the memory budget.\n",
+               memoryBudget.evictions);
+    }
+
+    int choice;
+    do {
+        bool valid = false;
+        showMenu();
+        while (readIntegerField(&inputReader, &choice, &valid) && !valid) {
+            printf("Invalid input. Enter a number (1-6): ");
+        }
+        if (!valid) choice = 6; // end of input
+
+        if (useBurstTrie && choice >= 3 && choice <= 5) {
+            printf("This option is not available with --burst-trie.\n");
+            continue;
         }
 
         switch (choice) {
             case 1: {
                 char prefix[MAX_WORD_LENGTH];
                 printf("Enter prefix to search: ");
-                if (scanf("%s", prefix) == 1) {
-                    if (!isValidWord(prefix)) {
+                if (readWordField(&inputReader, prefix)) {
+                    if (!*prefix) {
+                        printf("Invalid prefix. Only letters allowed.\n");
+                    } else if (useBurstTrie) {
+                        searchBurstWords(prefix);
+                    } else if (!isValidWord(prefix)) {
                         printf("Invalid prefix. Only letters allowed.\n");
                     } else {
-                        char* lowerPrefix = strtolower(prefix);
-                        TrieNode* current = root;
+                        char* lowerPrefix = queryLower(prefix);
+                        if (searchStaticPrefix(prefix, lowerPrefix)) break;
+                        ensureSnapshotPrefix(root, lowerPrefix);
+                        TrieNode* path[MAX_WORD_LENGTH + 1];
+                        int matched = 0;
                         bool found = true;
 
+                        // Remember the matched path so spell correction can resume from it
+                        path[0] = root;
                         for (int i = 0; lowerPrefix[i]; ++i) {
                             int index = lowerPrefix[i] - 'a';
-                            if (!current->children[index]) {
+                            if (!path[matched]->children[index]) {
                                 found = false;
                                 break;
                             }
-                            current = current->children[index];
+                            path[matched + 1] = childNode(path[matched], index);
+                            matched++;
                         }
 
-                        if (found) {
+                        if (found || scanTail(root, lowerPrefix, NULL) > 0) {
                             searchWordsByPrefix(root, prefix);
                         } else {
                             printf("No words with prefix \"%s\". Trying spell correction...\n", prefix);
-                            suggestSimilarWords(prefix, &dict);
+                            ensureSnapshotAll(root);
+                            suggestSimilarFromPath(path, matched, lowerPrefix);
                         }
-                        free(lowerPrefix);
                     }
                 }
                 break;
@@ -410,28 +5140,149 @@ int main() {
             case 2: {
                 printf("\nAll words in the Trie:\n");
                 char buffer[MAX_WORD_LENGTH];
+                if (!useBurstTrie) {
+                    // Streamed straight from the trie, already in alphabetical order
+                    int listed = 0;
+                    ensureSnapshotAll(root);
+                    streamCompletions(root, "", COMPLETION_LEXICOGRAPHIC, printListedWord, &listed);
+                    break;
+                }
                 Dictionary allWords = { .count = 0 };
-                collectAllWords(root, &allWords);
+                if (burstRoot) collectBurstNode(burstRoot, NULL, &allWords);
                 
                 // Sort words alphabetically
-                qsort(allWords.words, allWords.count, sizeof(char*), 
-                      (int (*)(const void*, const void*))strcmp);
+                qsort(allWords.words, allWords.count, sizeof(char*), compareWords);
                 
                 for (int i = 0; i < allWords.count; ++i) {
                     printf("%3d. %s\n", i+1, allWords.words[i]);
                 }
-                freeDictionary(&allWords);
                 break;
             }
-            case 3:
+            case 3: {
+                char prefix[MAX_WORD_LENGTH];
+                char* categories;
+                size_t length;
+                bool valid;
+                printf("Enter prefix to search: ");
+                if (!readWordField(&inputReader, prefix)) break;
+                if (!*prefix || !isValidWord(prefix)) {
+                    printf("Invalid prefix. Only letters allowed.\n");
+                    break;
+                }
+                printf("Enter categories (comma-separated, * for any): ");
+                if (!(categories = readField(&inputReader, &length))) break;
+
+                SearchFilter filter = { 0, 0, INT_MIN };
+                if (strcmp(categories, "*") != 0) {
+                    filter.tags = parseTagList(categories, false);
+                    if (!filter.tags) {
+                        printf("No words in those categories.\n");
+                        break;
+                    }
+                }
+                int minFrequency;
+                printf("Enter maximum word length (0 for any): ");
+                if (!readIntegerField(&inputReader, &filter.maxLength, &valid)) break;
+                if (!valid || filter.maxLength < 0) filter.maxLength = 0;
+                printf("Enter minimum frequency (0 for any): ");
+                if (!readIntegerField(&inputReader, &minFrequency, &valid)) break;
+                if (valid && minFrequency > 0) filter.minFrequency = minFrequency;
+                ensureSnapshotPrefix(root, queryLower(prefix));
+                searchWordsByPrefixFiltered(root, prefix, &filter);
+                break;
+            }
+            case 4: {
+                char prefix[MAX_WORD_LENGTH];
+                int pageSize;
+                bool valid;
+                printf("Enter prefix to search: ");
+                if (!readWordField(&inputReader, prefix)) break;
+                if (!*prefix || !isValidWord(prefix)) {
+                    printf("Invalid prefix. Only letters allowed.\n");
+                    break;
+                }
+                printf("Enter page size (1-%d): ", MAX_PAGE_SIZE);
+                if (!readIntegerField(&inputReader, &pageSize, &valid)) break;
+                if (!valid || pageSize < 1 || pageSize > MAX_PAGE_SIZE) {
+                    printf("Invalid page size.\n");
+                    break;
+                }
+
+                char* lowerPrefix = queryLower(prefix);
+                Suggestion* page = (Suggestion*)queryAlloc(pageSize * sizeof(Suggestion));
+                ensureSnapshotPrefix(root, lowerPrefix);
+
+                CompletionCursor cursor;
+                openCompletionCursor(&cursor, root, lowerPrefix);
+                int shown = 0;
+                for (;;) {
+                    int produced = nextCompletionPage(&cursor, page, pageSize);
+                    for (int i = 0; i < produced; ++i) {
+                        printf("%4d. %s (frequency: %d)\n", ++shown, page[i].word, page[i].frequency);
+                    }
+                    if (produced < pageSize) {
+                        printf(shown ? "No more completions for \"%s\".\n"
+                                     : "No suggestions found for \"%s\".\n", prefix);
+                        break;
+                    }
+                    size_t length;
+                    printf("Show next page? (y/n): ");
+                    char* more = readField(&inputReader, &length);
+                    if (!more || (*more != 'y' && *more != 'Y')) break;
+                }
+                closeCompletionCursor(&cursor);
+                break;
+            }
+            case 5: {
+                char word[MAX_WORD_LENGTH];
+                printf("Enter word to check: ");
+                if (!readWordField(&inputReader, word)) break;
+                if (!*word || !isValidWord(word)) {
+                    printf("Invalid word. Only letters allowed.\n");
+                    break;
+                }
+                char* lowerWord = queryLower(word);
+                ensureSnapshotAll(root);
+
+                // One probe into the perfect hash; walk the trie only if it is unavailable
+                WordTable* table = getWordTable(root);
+                PerfectHash* ph = getPerfectHash(table);
+                int id = ph ? lookupWordId(ph, table, lowerWord) : -1;
+                TrieNode* node = ph ? NULL : findNode(root, lowerWord);
+                if (id >= 0) {
+                    printf("\"%s\" is spelled correctly (frequency: %d).\n", table->words[id],
+                           table->frequencies[id]);
+                } else if (node && node->isEndOfWord) {
+                    printf("\"%s\" is spelled correctly (frequency: %d).\n", nodePayload(node)->originalWord,
+                           nodePayload(node)->frequency);
+                } else {
+                    printf("\"%s\" is not in the dictionary.\n", word);
+                    suggestSimilarWords(lowerWord, table);
+                }
+                break;
+            }
+            case 6:
                 printf("Exiting...\n");
                 break;
             default:
                 printf("Invalid choice. Try again.\n");
         }
-    } while (choice != 3);
+        resetQueryArena(); // the answer is printed; drop everything the query allocated
+    } while (choice != 6);
 
+    freeHotPrefixes();
+    freeBurstNode(burstRoot);
+    freeGramIndex(&gramIndex);
+    freePerfectHash(&perfectHash);
+    freeWordTable(&wordTable);
     freeTrie(root);
-    freeDictionary(&dict);
+    freeTagRegistry();
+    freeLineReader(&inputReader);
+    freeQueryArena();
+    free(querySketch.counters);
+    closeSnapshot();
+    closeTailFile();
+    freeMemoryBudget();
+    destroyNodeArena();
     return 0;
 }